@@ -0,0 +1,87 @@
+// Array template
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// A growable array: items are contiguous and indexable.  It doubles
+// in size when it fills up, so pointers to items are only good until
+// the next add().
+
+template<class T>
+class Array
+  {
+  public:
+
+  T *vals; // Items
+  int dlen; // No. items in array
+  int size; // No. items allocated
+
+  // Return number of items in array
+  int len()
+    {
+    return dlen;
+    }
+
+  // Return reference so it can be used on the left side
+  T &operator[](int i)
+    {
+    return vals[i];
+    }
+
+  // Make sure there is room for at least n items
+  void reserve(int n)
+    {
+    if (n > size)
+      {
+      int x;
+      int newsize = size ? size : 8;
+      while (newsize < n)
+        newsize *= 2;
+      T *newvals = new T[newsize];
+      for (x = 0; x != dlen; ++x)
+        newvals[x] = vals[x];
+      delete[] vals;
+      vals = newvals;
+      size = newsize;
+      }
+    }
+
+  // Add item to end of array
+  void add(T val)
+    {
+    if (dlen == size)
+      reserve(dlen + 1);
+    vals[dlen++] = val;
+    }
+
+  // Remove all items (keeps the memory for reuse)
+  void clear()
+    {
+    dlen = 0;
+    }
+
+  // Return an exactly sized copy of the items (caller deletes it with delete[])
+  T *copy()
+    {
+    int x;
+    T *n;
+    if (!dlen)
+      return 0;
+    n = new T[dlen];
+    for (x = 0; x != dlen; ++x)
+      n[x] = vals[x];
+    return n;
+    }
+
+  Array()
+    {
+    vals = 0;
+    dlen = 0;
+    size = 0;
+    }
+
+  ~Array()
+    {
+    delete[] vals;
+    }
+  };
@@ -0,0 +1,130 @@
+// Bill of materials output
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Counts parts in the whole design by library, part, value and package,
+// written as CSV:
+//
+// Count,Library,Part,Value,Package
+// 12,TTL.LIB,74LS00,74LS00,14PDIP
+//
+// The design is not flattened: each sheet's totals are figured once, from
+// its own parts plus the totals of the sheets it instantiates (cells
+// come leaves first from cell_order()).  Sections of a package (U1A,
+// U1B) count as one part.  Parts of sheets which have a |sim model
+// aren't in the design: they are left out with a warning.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "inf.h"
+#include "outfile.h"
+#include "bom.h"
+
+// Quote field if it needs it
+
+static string bom_field(const string& s)
+  {
+  int x;
+  if (!strpbrk(s.c_str(), ",\"\n"))
+    return s;
+  string r = "\"";
+  for (x = 0; x != (int)s.length(); ++x)
+    if (s[x] == '"')
+      r += "\"\"";
+    else
+      r += s[x];
+  return r + "\"";
+  }
+
+// Parts of one cell: count by library\0part\0value\0package
+
+typedef Hash<int> BomTotals;
+
+static BomTotals *bom_cell(Cell *c, Hash<BomTotals *>& totals)
+  {
+  BomTotals *t = new BomTotals();
+  Hash<int> seen; // Refdes already counted
+  Hash<View *>::ptr vptr;
+  Hash<Instance *>::ptr iptr;
+  for (vptr = c->views.first(); vptr; vptr++)
+    for (iptr = vptr->instances.first(); iptr; iptr++)
+      {
+      Instance *i = *iptr;
+      Cell *s = i->ref.cell;
+      if (s && !s->mom->lib_type)
+        {
+        // Sheet: add in its totals.  A sheet replaced by a simulation
+        // model has no parts in the design.
+        if (i->ref.view && i->ref.view->sim.len())
+          cerr << "Warning: " << i->name.name << " in " << c->name.name << " has a simulation model: its parts are not in the BOM\n";
+        BomTotals *st = totals.get(s->mom->name.name + '\0' + s->name.name);
+        BomTotals::ptr p;
+        if (st)
+          for (p = st->first(); p; p++)
+            (*t)[p.key()] = t->get(p.key()) + *p;
+        }
+      else if (InfInstance *inf = i->inf)
+        {
+        if (!seen.get(inf->name))
+          {
+          string key = inf->library + '\0' + inf->library_part_name + '\0' + inf->part_value + '\0' + inf->module_field;
+          seen[inf->name] = 1;
+          (*t)[key] = t->get(key) + 1;
+          }
+        }
+      else
+        {
+        // Part from EDIF: all we know is library and cell
+        string key = i->ref.libraryRef + '\0' + i->ref.cellRef + '\0' + '\0';
+        (*t)[key] = t->get(key) + 1;
+        }
+      }
+  return t;
+  }
+
+void bom_dump(Design *d, Out& out)
+  {
+  Array<Cell *> order;
+  Hash<BomTotals *> totals; // Totals by library\0cell
+  Cell *top = find_top(d);
+  int x;
+  if (!top)
+    {
+    cerr << "couldn't find top cell\n";
+    exit(-1);
+    }
+  cell_order(d, order);
+  for (x = 0; x != order.len(); ++x)
+    totals.add(order[x]->mom->name.name + '\0' + order[x]->name.name, bom_cell(order[x], totals));
+
+  out << "Count,Library,Part,Value,Package\n";
+  BomTotals *t = totals.get(top->mom->name.name + '\0' + top->name.name);
+  BomTotals::ptr p;
+  for (p = t->first(); p; p++)
+    {
+    string key = p.key();
+    out << *p;
+    int s = 0, e;
+    while ((e = key.find('\0', s)) != (int)string::npos)
+      {
+      out << ',' << bom_field(key.substr(s, e - s));
+      s = e + 1;
+      }
+    out << ',' << bom_field(key.substr(s)) << '\n';
+    }
+
+  Hash<BomTotals *>::ptr tp;
+  for (tp = totals.first(); tp; tp++)
+    delete *tp;
+  }
@@ -0,0 +1,6 @@
+// Bill of materials output
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Write part counts for whole design as CSV
+void bom_dump(Design *d, Out& out);
@@ -0,0 +1,137 @@
+// Design TOP (flattened, 2 parts, 1 nets between parts)
+
+// Part 0: 5 instances, 6 ports
+
+module top_part0
+  (
+  sn,
+  q,
+  rn,
+  d,
+  enn,
+  bus
+  );
+
+// Declare ports
+input sn;
+output q;
+input rn;
+input d;
+input enn;
+inout bus;
+
+// Declare nets
+wire qb;
+wire enb;
+
+// Instances
+nand u1a (q, sn, qb);
+
+nand u1b (qb, rn, q);
+
+bufif0 u2a (bus, d, enn);
+
+bufif0 u2b (bus, q, enb);
+
+not u3a (enb, enn);
+
+
+endmodule
+
+// Part 1: 5 instances, 3 ports
+
+module top_part1
+  (
+  bus,
+  busn,
+  z
+  );
+
+// Declare ports
+inout bus;
+output busn;
+output z;
+
+// Declare nets
+wire \sub1/mid ;
+wire \sub1/g0 ;
+wire \sub1/g1 ;
+
+// Instances
+not u3b (busn, bus);
+
+r r1
+  (
+  .1 (bus),
+  .2 ()
+  );
+
+not \sub1/u1a  (\sub1/mid , busn);
+
+not \sub1/u1b  (z, \sub1/mid );
+
+conn4 \sub1/j1 
+  (
+  .gnd (\sub1/g0 ),
+  .sig (\sub1/mid ),
+  .gnd (\sub1/g1 ),
+  .nc ()
+  );
+
+
+endmodule
+
+// TOP
+
+module top
+  (
+  sn,
+  rn,
+  d,
+  enn,
+  q,
+  busn,
+  z
+  );
+
+// Declare ports
+input sn;
+input rn;
+input d;
+input enn;
+output q;
+output busn;
+output z;
+
+// Declare nets
+wire bus;
+
+// Connect ports to nets
+// port name == net name == sn
+// port name == net name == rn
+// port name == net name == q
+// port name == net name == d
+// port name == net name == enn
+// port name == net name == busn
+// port name == net name == z
+
+// Parts
+top_part0 part0
+  (
+  .sn (sn),
+  .q (q),
+  .rn (rn),
+  .d (d),
+  .enn (enn),
+  .bus (bus)
+  );
+
+top_part1 part1
+  (
+  .bus (bus),
+  .busn (busn),
+  .z (z)
+  );
+
+
+endmodule
@@ -0,0 +1,68 @@
+#!/bin/sh
+# Regression check: run netlist on the fixture design in this directory
+# and compare what it writes with the files in expect/.  Run by "make
+# check" in the directory above.  After a change which is supposed to
+# change the output, look at the differences and then copy out/* to
+# expect/.
+#
+#   top.inf, sub.inf   Two-sheet design: a nand latch (a combinational
+#                      loop), a tristate bus with two 74LS125 drivers and a
+#                      connector with two GND pins
+#   changed/           The same design with one pin moved and a net renamed
+#   gatemap, stim      Gate mapping and vectors for -ofmt sim
+#   query              Requests for -query
+
+N=../netlist
+failed=0
+
+# Outputs are written to files: progress messages go to stdout
+rm -rf out
+mkdir out
+
+$N -ifmt orcad_inf -gatemap gatemap -stim stim -parts 2 \
+   -ofmt net=out/net,jsonl=out/jsonl,pcb=out/pcb,levels=out/levels,verilog_part=out/part.v,sim=out/sim \
+   top.inf > out/log || failed=1
+
+# First run writes the cache, second one reads it: both must match the
+# run without it
+$N -ifmt orcad_inf -cache out/cache -ofmt jsonl=out/jsonl.write top.inf >> out/log || failed=1
+$N -ifmt orcad_inf -cache out/cache -ofmt jsonl=out/jsonl.read top.inf >> out/log || failed=1
+
+# Replies come after the progress messages
+$N -ifmt orcad_inf -query query top.inf | grep -v '^Loading \|^Linking\.\.\.$\|^Supply hookup\.\.\.$' > out/query
+
+# Exit status of -diff is 0 for no differences, 1 for some
+$N -ifmt orcad_inf -diff top.inf top.inf > out/same.log
+echo "status $?" > out/same
+sed -n '/^--- /,$p' out/same.log >> out/same
+$N -ifmt orcad_inf -diff top.inf changed/top.inf > out/diff.log
+echo "status $?" > out/diff
+sed -n '/^--- /,$p' out/diff.log >> out/diff
+
+# Compare out/$1 with expect/$2 (default the same name)
+check()
+  {
+  e=expect/${2:-$1}
+  if cmp -s $e out/$1
+    then
+    echo "ok   $1"
+    else
+    echo "FAIL $1"
+    diff -u $e out/$1 | head -20
+    failed=1
+    fi
+  }
+
+for f in net jsonl pcb levels part.v sim query same diff
+  do
+  check $f
+  done
+check jsonl.write jsonl
+check jsonl.read jsonl
+
+if [ $failed != 0 ]
+  then
+  echo "make check failed (see check/out)"
+  exit 1
+  fi
+echo "make check passed"
@@ -0,0 +1,208 @@
+// Chunked list template
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Like Dlist, but items are stored contiguously in blocks instead of
+// getting a heap node each.  The first block holds 16 items, the rest
+// hold 64.  Use this for lists which are only appended to and walked in
+// order: joins, join items, pipe lines.
+
+#include <new>
+#include <stdlib.h>
+
+template<class T>
+class Clist
+  {
+  public:
+
+  enum
+    {
+    FIRST_SIZE = 16, // Size of first block
+    BLOCK_SIZE = 64 // Size of later blocks
+    };
+
+  struct Block
+    {
+    Block *bnext;
+    Block *bprev;
+    int n; // No. items used in this block
+    int size; // No. items which fit in this block
+    // Items follow the header
+    T *vals()
+      {
+      return (T *)(this + 1);
+      }
+    };
+  Block *dfirst; // First block
+  Block *dlast; // Last block
+  int dlen; // No. items in list
+
+  // Return number of items in list
+  int len()
+    {
+    return dlen;
+    }
+
+  // We automatically cast to this for type-safe (ptr==NULL) tests.
+  typedef Block *Blockpointer;
+
+  struct ptr
+    {
+    Block *b;
+    int i;
+    // Automatic conversion to pointer for (ptr==NULL) tests
+    operator Blockpointer()
+      {
+      return b;
+      }
+    // Get item at pointer
+    T operator*()
+      {
+      return b->vals()[i];
+      }
+    // Get item at pointer
+    T val()
+      {
+      return b->vals()[i];
+      }
+    // pointer de-reference
+    T operator->()
+      {
+      return b->vals()[i];
+      }
+    // Get reference to item at pointer (it doesn't move)
+    T &item()
+      {
+      return b->vals()[i];
+      }
+    // Get next pointer
+    ptr next()
+      {
+      ptr n(b, i);
+      n++;
+      return n;
+      }
+    // Get previous pointer
+    ptr prev()
+      {
+      ptr n(b, i);
+      n--;
+      return n;
+      }
+    // Move pointer to next
+    void operator++(int)
+      {
+      if (++i == b->n)
+        {
+        b = b->bnext;
+        i = 0;
+        }
+      }
+    // Move pointer to next
+    void operator++()
+      {
+      (*this)++;
+      }
+    // Move pointer to prev
+    void operator--(int)
+      {
+      if (!i--)
+        {
+        b = b->bprev;
+        if (b)
+          i = b->n - 1;
+        }
+      }
+    // Move pointer to prev
+    void operator--()
+      {
+      (*this)--;
+      }
+    ptr()
+      {
+      }
+    ptr(Block *nb, int ni)
+      {
+      b = nb;
+      i = ni;
+      }
+    };
+
+  // Get first pointer
+  ptr first()
+    {
+    ptr p(dfirst, 0);
+    return p;
+    }
+
+  // Get last pointer
+  ptr last()
+    {
+    ptr p(dlast, dlast ? dlast->n - 1 : 0);
+    return p;
+    }
+
+  // Create list
+  Clist()
+    {
+    dfirst = 0;
+    dlast = 0;
+    dlen = 0;
+    }
+
+  // Delete list (but not what items point to)
+  ~Clist()
+    {
+    Block *b, *n;
+    for (b = dfirst; b; b = n)
+      {
+      int x;
+      n = b->bnext;
+      for (x = 0; x != b->n; ++x)
+        b->vals()[x].~T();
+      free(b);
+      }
+    }
+
+  // Return reference so it can be used on the left side
+  T &operator[](int i)
+    {
+    Block *b;
+    for (b = dfirst; i >= b->n; b = b->bnext)
+      i -= b->n;
+    return b->vals()[i];
+    }
+
+  // Search by value
+  ptr search(T val)
+    {
+    ptr p;
+    for (p = first(); p; p++)
+      if (*p == val)
+        break;
+    return p;
+    }
+
+  // Add item to end of list (push_back)
+  void add(T val)
+    {
+    if (!dlast || dlast->n == dlast->size)
+      {
+      int size = dlast ? BLOCK_SIZE : FIRST_SIZE;
+      Block *b = (Block *)malloc(sizeof(Block) + size * sizeof(T));
+      b->bnext = 0;
+      b->bprev = dlast;
+      b->n = 0;
+      b->size = size;
+      if (dlast)
+        dlast->bnext = b;
+      else
+        dfirst = b;
+      dlast = b;
+      }
+    new (dlast->vals() + dlast->n) T(val);
+    ++dlast->n;
+    ++dlen;
+    }
+  };
@@ -0,0 +1,349 @@
+// Design differences
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Compares two designs cell by cell, independent of the order of anything
+// in the files:
+//
+//   - cell SUB2                      Cell only in old design
+//   + cell SUB3                      Cell only in new design
+//   cell TOP                         Differences in this cell follow
+//   - port X                         Port only in old
+//   ~ port Z: in -> out              Port direction changed
+//   + instance U7: TTL.LIB 74LS04    Instance only in new
+//   ~ instance U3: TTL.LIB 74LS00 -> TTL.LIB 74LS04
+//   - net N1: U1.A U2.B              Net only in old, with its pins
+//   ~ net CLK: +U7.CLK -U5.CLK       Same name, different pins
+//   ~ model                          Simulation model text changed
+//
+// Pins are INSTANCE.PORT, or just PORT for ports of the cell itself.
+// Nets are matched by what they connect, not by name: a net with the
+// same pins in both designs is the same net, even if its name changed (as
+// generated names do).  The pins of each net are sorted into one string,
+// which is looked up in a hash table of the other design's nets, so each
+// view takes linear time.  When several nets connect the same pins (nets
+// with no pins at all, say), ones with the same name are paired first.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+#include "diff.h"
+
+// Name of a pin
+
+static string diff_pin(Portref *r)
+  {
+  if (r->instance)
+    return r->instance->name.name + "." + r->portRef;
+  else if (r->instanceRef.length())
+    return r->instanceRef + "." + r->portRef;
+  else
+    return r->portRef;
+  }
+
+// Pins of a net, sorted
+
+static void diff_pins(Net *n, Array<string>& l)
+  {
+  for (Portref *r = n->pins; r; r = r->next)
+    l.add(diff_pin(r));
+  if (l.len())
+    sort(&l[0], &l[0] + l.len());
+  }
+
+// What a net connects, for matching
+
+static string diff_form(Net *n)
+  {
+  Array<string> l;
+  string s;
+  int x;
+  diff_pins(n, l);
+  for (x = 0; x != l.len(); ++x)
+    s += l[x] + '\n';
+  return s;
+  }
+
+static const char *diff_dir(Port *p)
+  {
+  switch (p->direction)
+    {
+    case 0: return "in";
+    case 1: return "out";
+    case 2: return "inout";
+    }
+  return "?";
+  }
+
+static string diff_ref(Instance *i)
+  {
+  return i->ref.libraryRef + " " + i->ref.cellRef;
+  }
+
+// Write header for cell before its first difference
+
+static void diff_cell(Out& out, Cell *c, int& shown)
+  {
+  if (!shown)
+    out << "cell " << c->name.name << '\n';
+  shown = 1;
+  }
+
+// Nets of b which connect the same pins
+
+struct DiffForm
+  {
+  Array<Net *> nets;
+  int next; // Nets before this one are matched
+  };
+
+// Compare two views of a cell.  Returns no. differences.
+
+static int diff_view(Out& out, Cell *c, View *a, View *b, int& shown)
+  {
+  Hash<Port *>::ptr pp;
+  Hash<Instance *>::ptr ip;
+  Hash<Net *>::ptr np;
+  Hash<DiffForm *> bforms; // Nets of b by what they connect
+  Hash<string> bform_of; // What each net of b connects, by name
+  Hash<int> matched; // Nets of b which match one in a
+  Array<Net *> arest; // Nets of a without a match of the same name
+  Array<Net *> agone; // Nets of a which don't match
+  Hash<Net *> bleft; // Nets of b which don't match, by name
+  Hash<int> changed; // Nets of bleft reported as changed
+  int n = 0;
+  int x;
+
+  for (pp = a->ports.first(); pp; pp++)
+    {
+    Port *q = b->ports.get(pp->name.name);
+    if (!q)
+      {
+      diff_cell(out, c, shown);
+      out << "- port " << pp->name.name << '\n';
+      ++n;
+      }
+    else if (q->direction != pp->direction)
+      {
+      diff_cell(out, c, shown);
+      out << "~ port " << pp->name.name << ": " << diff_dir(*pp) << " -> " << diff_dir(q) << '\n';
+      ++n;
+      }
+    }
+  for (pp = b->ports.first(); pp; pp++)
+    if (!a->ports.get(pp->name.name))
+      {
+      diff_cell(out, c, shown);
+      out << "+ port " << pp->name.name << '\n';
+      ++n;
+      }
+
+  for (ip = a->instances.first(); ip; ip++)
+    {
+    Instance *j = b->instances.get(ip->name.name);
+    if (!j)
+      {
+      diff_cell(out, c, shown);
+      out << "- instance " << ip->name.name << ": " << diff_ref(*ip) << '\n';
+      ++n;
+      }
+    else if (diff_ref(*ip) != diff_ref(j))
+      {
+      diff_cell(out, c, shown);
+      out << "~ instance " << ip->name.name << ": " << diff_ref(*ip) << " -> " << diff_ref(j) << '\n';
+      ++n;
+      }
+    }
+  for (ip = b->instances.first(); ip; ip++)
+    if (!a->instances.get(ip->name.name))
+      {
+      diff_cell(out, c, shown);
+      out << "+ instance " << ip->name.name << ": " << diff_ref(*ip) << '\n';
+      ++n;
+      }
+
+  // Match nets by what they connect, same names first
+  for (np = b->nets.first(); np; np++)
+    {
+    string f = diff_form(*np);
+    DiffForm *d = bforms.get(f);
+    if (!d)
+      {
+      d = new DiffForm();
+      d->next = 0;
+      bforms.add(f, d);
+      }
+    d->nets.add(*np);
+    bform_of.add(np->name.name, f);
+    }
+  for (np = a->nets.first(); np; np++)
+    {
+    string f = diff_form(*np);
+    Hash<string>::ptr bf = bform_of.find(np->name.name);
+    if (bf && *bf == f && !matched.get(np->name.name))
+      matched.add(np->name.name, 1);
+    else
+      arest.add(*np);
+    }
+  for (x = 0; x != arest.len(); ++x)
+    {
+    DiffForm *d = bforms.get(diff_form(arest[x]));
+    if (d)
+      while (d->next != d->nets.len() && matched.get(d->nets[d->next]->name.name))
+        ++d->next;
+    if (d && d->next != d->nets.len())
+      matched.add(d->nets[d->next++]->name.name, 1);
+    else
+      agone.add(arest[x]);
+    }
+  for (np = b->nets.first(); np; np++)
+    if (!matched.get(np->name.name))
+      bleft.add(np->name.name, *np);
+  Hash<DiffForm *>::ptr fp;
+  for (fp = bforms.first(); fp; fp++)
+    delete *fp;
+
+  // Unmatched nets with the same name changed, others came or went
+  for (x = 0; x != agone.len(); ++x)
+    {
+    Net *an = agone[x];
+    Net *bn = bleft.get(an->name.name);
+    Array<string> al;
+    int y;
+    diff_pins(an, al);
+    ++n;
+    if (bn)
+      {
+      Array<string> bl;
+      Hash<int> in_a, in_b;
+      diff_pins(bn, bl);
+      for (y = 0; y != al.len(); ++y)
+        in_a.add(al[y], 1);
+      for (y = 0; y != bl.len(); ++y)
+        in_b.add(bl[y], 1);
+      string d;
+      for (y = 0; y != bl.len(); ++y)
+        if (!in_a.get(bl[y]))
+          d += " +" + bl[y];
+      for (y = 0; y != al.len(); ++y)
+        if (!in_b.get(al[y]))
+          d += " -" + al[y];
+      // Only the number of times a pin is listed differs
+      if (d.empty())
+        --n;
+      else
+        {
+        diff_cell(out, c, shown);
+        out << "~ net " << an->name.name << ':' << d << '\n';
+        }
+      changed.add(bn->name.name, 1);
+      }
+    else
+      {
+      diff_cell(out, c, shown);
+      out << "- net " << an->name.name << ':';
+      for (y = 0; y != al.len(); ++y)
+        out << ' ' << al[y];
+      out << '\n';
+      }
+    }
+  Hash<Net *>::ptr bp;
+  for (bp = bleft.first(); bp; bp++)
+    if (!changed.get(bp->name.name))
+      {
+      Array<string> bl;
+      int y;
+      diff_pins(*bp, bl);
+      diff_cell(out, c, shown);
+      out << "+ net " << bp->name.name << ':';
+      for (y = 0; y != bl.len(); ++y)
+        out << ' ' << bl[y];
+      out << '\n';
+      ++n;
+      }
+
+  // Model text
+  Clist<string>::ptr sa = a->sim.first(), sb = b->sim.first();
+  while (sa && sb && *sa == *sb)
+    {
+    ++sa;
+    ++sb;
+    }
+  if (sa || sb)
+    {
+    diff_cell(out, c, shown);
+    out << "~ model\n";
+    ++n;
+    }
+  return n;
+  }
+
+int diff_designs(Design *a, Design *b, Out& out)
+  {
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  Hash<View *>::ptr vptr;
+  int n = 0;
+
+  // Cells are looked up by name in any design library
+  Hash<Cell *> bcells;
+  for (lptr = b->libraries.first(); lptr; lptr++)
+    if (!lptr->lib_type)
+      for (cptr = lptr->cells.first(); cptr; cptr++)
+        bcells.add(cptr->name.name, *cptr);
+
+  Hash<int> seen;
+  for (lptr = a->libraries.first(); lptr; lptr++)
+    if (!lptr->lib_type)
+      for (cptr = lptr->cells.first(); cptr; cptr++)
+        {
+        Cell *c = *cptr;
+        Cell *bc = bcells.get(c->name.name);
+        int shown = 0;
+        seen.add(c->name.name, 1);
+        if (!bc)
+          {
+          out << "- cell " << c->name.name << '\n';
+          ++n;
+          continue;
+          }
+        for (vptr = c->views.first(); vptr; vptr++)
+          {
+          View *bv = bc->views.get(vptr->name.name);
+          if (bv)
+            n += diff_view(out, c, *vptr, bv, shown);
+          else
+            {
+            diff_cell(out, c, shown);
+            out << "- view " << vptr->name.name << '\n';
+            ++n;
+            }
+          }
+        for (vptr = bc->views.first(); vptr; vptr++)
+          if (!c->views.get(vptr->name.name))
+            {
+            diff_cell(out, c, shown);
+            out << "+ view " << vptr->name.name << '\n';
+            ++n;
+            }
+        }
+  for (cptr = bcells.first(); cptr; cptr++)
+    if (!seen.get(cptr->name.name))
+      {
+      out << "+ cell " << cptr->name.name << '\n';
+      ++n;
+      }
+  return n;
+  }
@@ -0,0 +1,7 @@
+// Design differences
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Write differences between old design a and new design b.  Returns no.
+// differences.
+int diff_designs(Design *a, Design *b, Out& out);
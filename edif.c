@@ -16,6 +16,8 @@ extern string legalize_string(string s);
 
 #include "hash.h"
 #include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "lisp.h"
 #include "net.h"
 #include "edif.h"
@@ -52,7 +54,7 @@ Name parsename(Node *n)
   else
     {
     cerr << n->file_name << " " << n->line << ": Error: unknown name format\n";
-    exit(-1);
+    throw LoadError();
     }
   return name;
   }
@@ -66,7 +68,7 @@ string parserefname(Node *n)
   else
     {
     cerr << n->file_name << " " << n->line << ": Error: bad ref name\n";
-    exit(-1);
+    throw LoadError();
     }
   }
 
@@ -80,7 +82,7 @@ Port *parseport(View *v,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing port name\n";
-      exit(-1);
+      throw LoadError();
       }
     port->name=parsename(n->list()->item->next);
     if(n->list()->item->next->next && n->list()->item->next->next->type==List_id &&
@@ -97,7 +99,7 @@ Port *parseport(View *v,Node *n)
       else
         {
         cerr << n->file_name << " " << n->line << ": Error: unknown direction on port\n";
-        exit(-1);
+        throw LoadError();
         }
       // port->misc_after=n->list()->item->next->next->next;
       return port;
@@ -105,7 +107,7 @@ Port *parseport(View *v,Node *n)
     else
       {
       cerr << n->file_name << " " << n->line << ": Error: bad or missing direction on port\n";
-      exit(-1);
+      throw LoadError();
       }
     }
   else
@@ -125,25 +127,25 @@ void parseportname(Portref *i,Node *n)
     if(!n->list()->item->next || n->list()->item->next->type!=Ident_id)
       {
       cerr << n->file_name << " " << n->line << ": Error: bad or missing portref name\n";
-      exit(-1);
+      throw LoadError();
       }
     i->portRef=lower(n->list()->item->next->ident()->s);
     if(!n->list()->item->next->next || n->list()->item->next->next->type!=Num_id)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing number in member\n";
-      exit(-1);
+      throw LoadError();
       }
     i->member=n->list()->item->next->next->num()->num;
     if(n->list()->item->next->next->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: extra junk in member\n";
-      exit(-1);
+      throw LoadError();
       }
     }
   else
     {
     cerr << n->file_name << " " << n->line << ": Error: bad portRef name\n";
-    exit(-1);
+    throw LoadError();
     }
   }
 
@@ -155,20 +157,20 @@ int parseinstanceref(View *v,Portref *i,Node *n)
     if(!n->list()->item->next || n->list()->item->next->type!=Ident_id)
       {
       cerr << n->file_name << " " << n->line << ": Error: Missing or bad instanceRef name\n";
-      exit(-1);
+      throw LoadError();
       }
     i->instanceRef=lower(n->list()->item->next->ident()->s);
     if(n->list()->item->next->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: Extra junk after instanceRef name\n";
-      exit(-1);
+      throw LoadError();
       }
     // Link
     i->instance=v->instances.get(i->instanceRef);
     if(!i)
       {
       cerr << n->file_name << " " << n->line << ": Error: Couldn't find instanceRef- used before defined?\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -185,7 +187,7 @@ Portref *parseportref(View *v,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: Missing port name\n";
-      exit(-1);
+      throw LoadError();
       }
     parseportname(i,n->list()->item->next);
     if(n->list()->item->next->next)
@@ -193,7 +195,7 @@ Portref *parseportref(View *v,Node *n)
       if(!parseinstanceref(v,i,n->list()->item->next->next) || n->list()->item->next->next->next)
         {
         cerr << n->file_name << " " << n->line << ": Error: Extra junk in portRef\n";
-        exit(-1);
+        throw LoadError();
         }
       }
     // Link
@@ -202,7 +204,7 @@ Portref *parseportref(View *v,Node *n)
       if(!i->instance->ref.view)
         {
         cerr << n->file_name << " " << n->line << ": Error: no viewref in instance?\n";
-        exit(-1);
+        throw LoadError();
         }
       i->port=i->instance->ref.view->ports.get(i->portRef);
       }
@@ -213,7 +215,7 @@ Portref *parseportref(View *v,Node *n)
     if(!i->port)
       {
       cerr << n->file_name << " " << n->line << ": Error: couldn't link port " << i->instanceRef << "." << i->portRef <<"\n";
-      exit(-1);
+      throw LoadError();
       }
     return i;
     }
@@ -232,7 +234,7 @@ int parsejoin(View *v,Net *i,Node *n)
       if(!r)
         {
         cerr << n->file_name << " " << n->line << ": Error: Unknown item in joined\n";
-        exit(-1);
+        throw LoadError();
         }
       r->next=i->pins;
       i->pins=r;
@@ -254,13 +256,13 @@ Net *parsenet(View *v,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: Missing net name\n";
-      exit(-1);
+      throw LoadError();
       }
     i->name=parsename(n->list()->item->next);
     if(!n->list()->item->next->next || !parsejoin(v,i,n->list()->item->next->next))
       {
       cerr << n->file_name << " " << n->line << ": Error: Empty net\n";
-      exit(-1);
+      throw LoadError();
       }
     // i->misc_after=n->list()->item->next->next->next;
 /*    if(n->list()->item->next->next->next)
@@ -283,19 +285,19 @@ int parselibraryref(View *v,Viewref *r,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing libraryRef name\n";
-      exit(-1);
+      throw LoadError();
       }
     r->libraryRef=parserefname(n->list()->item->next);
     if(n->list()->item->next->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: extra junk at end of libraryRef list\n";
-      exit(-1);
+      throw LoadError();
       }
     r->lib=v->mom->mom->mom->libraries.get(r->libraryRef);
     if(!r->lib)
       {
       cerr << n->file_name << " " << n->line << ": Error: forward ref or unknown library\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -311,7 +313,7 @@ int parsecellref(View *v,Viewref *r,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: Missing cellRef name\n";
-      exit(-1);
+      throw LoadError();
       }
     r->cellRef=parserefname(n->list()->item->next);
     if(!n->list()->item->next->next || !parselibraryref(v,r,n->list()->item->next->next))
@@ -326,26 +328,26 @@ int parsecellref(View *v,Viewref *r,Node *n)
       if(n->list()->item->next->next)
         {
         cerr << n->file_name << " " << n->line << ": Error: Extra junk at end of cellRef list\n";
-        exit(-1);
+        throw LoadError();
         }
       r->cell=r->lib->cells.get(r->cellRef);
       if(!r)
         {
         cerr << n->file_name << " " << n->line << ": Error: forward ref to or missing cell\n";
-        exit(-1);
+        throw LoadError();
         }
       return 1;
       }
     if(n->list()->item->next->next->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: Extra junk at end of cellRef list\n";
-      exit(-1);
+      throw LoadError();
       }
     r->cell=r->lib->cells.get(r->cellRef);
     if(!r)
       {
       cerr << n->file_name << " " << n->line << ": Error: forward ref to or missing cell\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -361,24 +363,24 @@ int parseviewref(View *v,Viewref *r,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing viewRef name\n";
-      exit(-1);
+      throw LoadError();
       }
     r->viewRef=parserefname(n->list()->item->next);
     if(!n->list()->item->next->next || !parsecellref(v,r,n->list()->item->next->next))
       {
       cerr << n->file_name << " " << n->line << ": Error: missing cellRef in viewRef\n";
-      exit(-1);
+      throw LoadError();
       }
     if(n->list()->item->next->next->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: extra junk at end of viewRef list\n";
-      exit(-1);
+      throw LoadError();
       }
     r->view=r->cell->views.get(r->viewRef);
     if(!r->view)
       {
       cerr << n->file_name << " " << n->line << ": Error: forward ref to or missing view in cell\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -396,13 +398,13 @@ Instance *parseinstance(View *v,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing instance name\n";
-      exit(-1);
+      throw LoadError();
       }
     i->name=parsename(n->list()->item->next);
     if(!n->list()->item->next->next || !parseviewref(v,&i->ref,n->list()->item->next->next))
       {
       cerr << n->file_name << " " << n->line << ": Error: missing view reference in instance\n";
-      exit(-1);
+      throw LoadError();
       }
     // i->misc_after=n->list()->item->next->next->next;
     return i;
@@ -437,7 +439,7 @@ int parseinterface(View *v,Node *n)
     if(first)
       {
       cerr << n->file_name << " " << n->line << ": Error: unexpected junk in interface\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -477,7 +479,7 @@ int parsecontents(View *v,Node *n)
     if(first)
       {
       cerr << n->file_name << " " << n->line << ": Error: unexpected junk in contents\n";
-      exit(-1);
+      throw LoadError();
       }
     return 1;
     }
@@ -499,7 +501,7 @@ View *parseview(Cell *cell,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing view name\n";
-      exit(-1);
+      throw LoadError();
       }
     view->name=parsename(n->list()->item->next);
     first=last=0;
@@ -542,7 +544,7 @@ Cell *parsecell(Lib *lib,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing cell name\n";
-      exit(-1);
+      throw LoadError();
       }
     cell->name=parsename(n->list()->item->next);
 //    cout << "Parsing " << cell->name.name << "\n";
@@ -591,7 +593,7 @@ Lib *parselibrary(Design *e,Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing library name\n";
-      exit(-1);
+      throw LoadError();
       }
     lib->name=parsename(n->list()->item->next);
     first=last=0;
@@ -633,7 +635,7 @@ Design *parse_edif(Node *n)
     if(!n->list()->item->next)
       {
       cerr << n->file_name << " " << n->line << ": Error: missing edif name\n";
-      exit(-1);
+      throw LoadError();
       }
     edif->name=parsename(n->list()->item->next);
     first=last=0;
@@ -0,0 +1,173 @@
+// Electrical rule checks
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Checks the flattened design, so that a net which goes through sheet
+// ports is checked as a whole.  Each flat net and each leaf pin is looked
+// at once:
+//
+//   Error: net with more than one totem-pole output, or a totem-pole
+//   output with three-state or open collector/emitter outputs
+//
+//   Warning: net with inputs but nothing which could drive them (an
+//   output of any kind, a bidirectional, passive, supply or unspecified
+//   pin, or an input or bidirectional port of the top cell)
+//
+//   Warning: part pin which is on no net, or is alone on its net (unless
+//   that net was reported already).  Supply pins are left out: they are
+//   usually hidden and connected by name.
+//
+// Pin types come from the .INF file.  For other inputs they come from
+// the port direction.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "flat.h"
+#include "erc.h"
+
+// No. pins to list in a message
+
+#define ERC_LIST 8
+
+// Type of port: .INF type, or made up from its direction
+
+static int erc_type(Port *p)
+  {
+  if (p->type)
+    return p->type;
+  if (p->supply)
+    return 'S';
+  switch (p->direction)
+    {
+    case 0: return 'I';
+    case 1: return 'O';
+    case 2: return 'B';
+    }
+  return 'U';
+  }
+
+// Name of flat pin for messages
+
+static string erc_pin(FlatPin *p)
+  {
+  if (p->inst)
+    return p->inst->path + "." + p->port->name.name;
+  else
+    return p->port->name.name;
+  }
+
+// Write list of pins, up to ERC_LIST of them
+
+static void erc_list(Array<FlatPin *>& l)
+  {
+  int x;
+  for (x = 0; x != l.len() && x != ERC_LIST; ++x)
+    cerr << ' ' << erc_pin(l[x]);
+  if (l.len() > ERC_LIST)
+    cerr << " (and " << l.len() - ERC_LIST << " more)";
+  cerr << '\n';
+  }
+
+int erc(Design *d)
+  {
+  Flat *f = flatten(d);
+  int errors = 0;
+  int warnings = 0;
+  int x, y;
+
+  if (!f)
+    {
+    cerr << "couldn't find top cell\n";
+    return -1;
+    }
+
+  cout << "Checking...\n";
+
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    Array<FlatPin *> totem; // Totem-pole outputs
+    Array<FlatPin *> other; // Three-state and open collector/emitter outputs
+    Array<FlatPin *> inputs;
+    int driven = 0;
+    for (y = 0; y != n->pins.len(); ++y)
+      {
+      FlatPin *p = &n->pins[y];
+      int type = erc_type(p->port);
+      if (!p->inst)
+        {
+        // Port of top cell: driven from outside unless it's an output
+        if (type != 'O')
+          driven = 1;
+        continue;
+        }
+      switch (type)
+        {
+        case 'O':
+          totem.add(p);
+          break;
+        case 'T': case 'C': case 'E':
+          other.add(p);
+          break;
+        case 'I':
+          inputs.add(p);
+          break;
+        default: // B, P, S or U
+          driven = 1;
+          break;
+        }
+      }
+    if (totem.len() > 1 || (totem.len() && other.len()))
+      {
+      cerr << "Error: net " << n->path << " has more than one driver:";
+      for (y = 0; y != other.len(); ++y)
+        totem.add(other[y]);
+      erc_list(totem);
+      ++errors;
+      }
+    else if (inputs.len() && !totem.len() && !other.len() && !driven)
+      {
+      cerr << "Warning: net " << n->path << " has inputs but no driver:";
+      erc_list(inputs);
+      ++warnings;
+      }
+    else if (n->pins.len() == 1 && n->pins[0].inst && erc_type(n->pins[0].port) != 'S')
+      {
+      cerr << "Warning: " << erc_pin(&n->pins[0]) << " is alone on net " << n->path << "\n";
+      ++warnings;
+      }
+    }
+
+  // Pins which are on no net
+  for (x = 0; x != f->insts.len(); ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    View *v = fi->inst->ref.view;
+    Hash<int> on; // Ports on a net
+    Hash<Port *>::ptr pp;
+    if (!v)
+      continue;
+    for (y = 0; y != fi->pins.len(); ++y)
+      on[fi->pins[y].port->name.name] = 1;
+    for (pp = v->ports.first(); pp; pp++)
+      if (!on.get(pp->name.name) && erc_type(*pp) != 'S')
+        {
+        cerr << "Warning: " << fi->path << "." << pp->name.name << " is not connected\n";
+        ++warnings;
+        }
+    }
+
+  cout << "ERC: " << errors << " errors, " << warnings << " warnings\n";
+  return errors;
+  }
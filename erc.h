@@ -0,0 +1,8 @@
+// Electrical rule checks
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Check design for nets with several drivers, undriven inputs and
+// unconnected part pins, messages to stderr.  Returns no. errors, or -1
+// if there is no top cell.
+int erc(Design *d);
@@ -0,0 +1,355 @@
+// Structural fingerprints
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Finds cells which are the same circuit under different names: same
+// ports, same kinds of instances, same connections, but any instance and
+// net names.  Each view gets a fingerprint (View::shape) by refining
+// labels of its instances and nets, like Weisfeiler-Lehman graph
+// hashing:
+//
+//   An instance's label starts as what it instantiates: library and cell
+//   name for parts, the shape of the sheet for sheets.  A net's label
+//   starts as its number of pins.  Each round, an instance's new label is
+//   a hash of its old one and of the (port name, net label) pairs of its
+//   pins, and a net's is a hash of its old one and of the (instance
+//   label, port name) pairs on it.  Rounds stop when no more labels split
+//   apart.
+//
+// Ports of the view keep their names, so cells with the same shape can
+// be used in place of each other.  Cells are done leaves first so that a
+// sheet's shape includes the shapes of the sheets it uses.
+//
+// Equal fingerprints aren't proof.  But when every instance and net ends
+// up with its own label, the view can be written out in label order, and
+// cells with the same text are the same for sure.  Those get Cell::same
+// set to the first of them.  Views with symmetry (labels which don't all
+// split) are only reported.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+#include "fingerprint.h"
+
+// A pin of an instance or of the view itself (inst is -1)
+
+struct ShapePin
+  {
+  int inst; // Index of instance or -1
+  int net; // Index of net
+  string port;
+  };
+
+// A label and what it's for, to put things in label order
+
+struct ShapeLabel
+  {
+  Hashval label;
+  int index;
+  bool operator<(const ShapeLabel& o) const { return label < o.label; }
+  };
+
+// Hash a list of labels in sorted order: the same labels in any order
+// give the same hash
+
+static Hashval shape_sorted(Array<Hashval>& l, Hashval h)
+  {
+  int x;
+  if (l.len())
+    sort(&l[0], &l[0] + l.len());
+  for (x = 0; x != l.len(); ++x)
+    h = hash_bytes((char *)&l[x], sizeof(Hashval), h);
+  return h;
+  }
+
+// Sort labels, returns no. distinct ones
+
+static int shape_order(Array<Hashval>& l, Array<ShapeLabel>& s)
+  {
+  int x, n = 0;
+  s.clear();
+  for (x = 0; x != l.len(); ++x)
+    {
+    ShapeLabel k;
+    k.label = l[x];
+    k.index = x;
+    s.add(k);
+    }
+  if (s.len())
+    stable_sort(&s[0], &s[0] + s.len());
+  for (x = 0; x != s.len(); ++x)
+    if (!x || s[x].label != s[x - 1].label)
+      ++n;
+  return n;
+  }
+
+// What an instance refers to, for the exact form
+
+static string shape_ref(Instance *i)
+  {
+  Cell *c = i->ref.cell;
+  if (c && !c->mom->lib_type)
+    {
+    if (c->same)
+      c = c->same;
+    return "cell " + c->mom->name.name + '/' + c->name.name;
+    }
+  return "part " + i->ref.libraryRef + '/' + i->ref.cellRef;
+  }
+
+// Fingerprint one view.  If labels all come out different, form is set
+// to its exact text, otherwise it's cleared.
+
+static Hashval shape_view(View *v, string& form)
+  {
+  Hash<int> inst_index; // Instance index by name
+  Hash<int> port_net; // Net index of each port of the view
+  Array<Instance *> insts;
+  Array<ShapePin> pins;
+  Array<Hashval> il, nl; // Labels of instances and nets
+  Array<Array<int> *> inst_pins, net_pins; // Pins of each instance and net
+  Array<ShapeLabel> is, ns; // Instances and nets in label order
+  Hash<Instance *>::ptr ip;
+  Hash<Net *>::ptr np;
+  Hash<Port *>::ptr pp;
+  Hashval h;
+  int x, y, classes;
+  char buf[40];
+
+  for (ip = v->instances.first(); ip; ip++)
+    {
+    Instance *i = *ip;
+    Cell *c = i->ref.cell;
+    inst_index.add(i->name.name, insts.len());
+    insts.add(i);
+    inst_pins.add(new Array<int>());
+    if (c && !c->mom->lib_type && i->ref.view)
+      il.add(hash_bytes((char *)&i->ref.view->shape, sizeof(Hashval), hash_string("sheet")));
+    else
+      il.add(hash_string(shape_ref(i)));
+    }
+  for (np = v->nets.first(); np; np++)
+    {
+    Array<int> *l = new Array<int>();
+    int n;
+    for (Portref *r = np->pins; r; r = r->next)
+      {
+      ShapePin p;
+      p.net = net_pins.len();
+      p.port = r->portRef;
+      p.inst = -1;
+      if (r->instance)
+        p.inst = inst_index.get(r->instance->name.name);
+      else
+        port_net.add(r->portRef, p.net);
+      l->add(pins.len());
+      if (p.inst != -1)
+        inst_pins[p.inst]->add(pins.len());
+      pins.add(p);
+      }
+    n = l->len();
+    nl.add(hash_bytes((char *)&n, sizeof(n), hash_string("net")));
+    net_pins.add(l);
+    }
+
+  // Refine until no labels split
+  classes = shape_order(il, is) + shape_order(nl, ns);
+  for (;;)
+    {
+    Array<Hashval> nil, nnl;
+    for (x = 0; x != inst_pins.len(); ++x)
+      {
+      Array<Hashval> l;
+      for (y = 0; y != inst_pins[x]->len(); ++y)
+        {
+        ShapePin& p = pins[(*inst_pins[x])[y]];
+        l.add(hash_string(p.port, nl[p.net]));
+        }
+      nil.add(shape_sorted(l, il[x]));
+      }
+    for (x = 0; x != net_pins.len(); ++x)
+      {
+      Array<Hashval> l;
+      for (y = 0; y != net_pins[x]->len(); ++y)
+        {
+        ShapePin& p = pins[(*net_pins[x])[y]];
+        l.add(hash_string(p.port, p.inst == -1 ? HASHVAL_INIT : il[p.inst]));
+        }
+      nnl.add(shape_sorted(l, nl[x]));
+      }
+    il.clear();
+    nl.clear();
+    for (x = 0; x != nil.len(); ++x)
+      il.add(nil[x]);
+    for (x = 0; x != nnl.len(); ++x)
+      nl.add(nnl[x]);
+    int n = shape_order(il, is) + shape_order(nl, ns);
+    if (n <= classes)
+      {
+      classes = n;
+      break;
+      }
+    classes = n;
+    }
+
+  // Fingerprint: labels, ports by name with their nets, model text
+  Array<Hashval> l;
+  for (x = 0; x != il.len(); ++x)
+    l.add(il[x]);
+  h = shape_sorted(l, hash_string("view"));
+  l.clear();
+  for (x = 0; x != nl.len(); ++x)
+    l.add(nl[x]);
+  h = shape_sorted(l, h);
+  l.clear();
+  for (pp = v->ports.first(); pp; pp++)
+    {
+    Hash<int>::ptr n = port_net.find(pp->name.name);
+    Hashval k = hash_bytes((char *)&pp->direction, sizeof(int), hash_string(pp->name.name));
+    l.add(n ? hash_bytes((char *)&nl[*n], sizeof(Hashval), k) : k);
+    }
+  h = shape_sorted(l, h);
+  for (Clist<string>::ptr sp = v->sim.first(); sp; ++sp)
+    h = hash_string(*sp, h);
+
+  // Exact form, with instances and nets numbered in label order
+  form.clear();
+  if (classes == insts.len() + net_pins.len())
+    {
+    Array<int> net_no;
+    Array<string> ports;
+    for (x = 0; x != ns.len(); ++x)
+      net_no.add(0);
+    for (x = 0; x != ns.len(); ++x)
+      net_no[ns[x].index] = x;
+    sprintf(buf, "nets %d\n", ns.len());
+    form += buf;
+    for (pp = v->ports.first(); pp; pp++)
+      {
+      Hash<int>::ptr n = port_net.find(pp->name.name);
+      sprintf(buf, " %d %d\n", pp->direction, n ? net_no[*n] : -1);
+      ports.add(pp->name.name + buf);
+      }
+    if (ports.len())
+      sort(&ports[0], &ports[0] + ports.len());
+    for (x = 0; x != ports.len(); ++x)
+      form += "port " + ports[x];
+    for (x = 0; x != is.len(); ++x)
+      {
+      int i = is[x].index;
+      Array<string> conns;
+      form += shape_ref(insts[i]);
+      for (y = 0; y != inst_pins[i]->len(); ++y)
+        {
+        ShapePin& p = pins[(*inst_pins[i])[y]];
+        sprintf(buf, "=%d", net_no[p.net]);
+        conns.add(p.port + buf);
+        }
+      if (conns.len())
+        sort(&conns[0], &conns[0] + conns.len());
+      for (y = 0; y != conns.len(); ++y)
+        form += " " + conns[y];
+      form += "\n";
+      }
+    for (Clist<string>::ptr sp = v->sim.first(); sp; ++sp)
+      form += "sim " + *sp + "\n";
+    }
+
+  for (x = 0; x != inst_pins.len(); ++x)
+    delete inst_pins[x];
+  for (x = 0; x != net_pins.len(); ++x)
+    delete net_pins[x];
+  return h;
+  }
+
+void fingerprint(Design *d)
+  {
+  Array<Cell *> order;
+  Hash<Cell *> forms; // First cell with each exact form
+  int x;
+  if (d->shaped)
+    return;
+  d->shaped = 1;
+  cell_order(d, order);
+  for (x = 0; x != order.len(); ++x)
+    {
+    Cell *c = order[x];
+    Hash<View *>::ptr vptr;
+    string all; // Exact forms of all views, or empty if one has none
+    int exact = 1;
+    for (vptr = c->views.first(); vptr; vptr++)
+      {
+      string form;
+      vptr->shape = shape_view(*vptr, form);
+      if (form.empty())
+        exact = 0;
+      all += "view " + vptr->name.name + "\n" + form;
+      }
+    if (exact && c->views.first())
+      {
+      Cell *o = forms.get(all);
+      if (o)
+        c->same = o;
+      else
+        forms.add(all, c);
+      }
+    }
+  }
+
+void dups_dump(Design *d, Out& out)
+  {
+  Array<Cell *> order;
+  Hash<Array<Cell *> *> groups; // Cells by shape of first view
+  Hash<Array<Cell *> *>::ptr gp;
+  char buf[40];
+  int x, n = 0;
+  fingerprint(d);
+  cell_order(d, order);
+  for (x = 0; x != order.len(); ++x)
+    {
+    View *v = *order[x]->views.first();
+    if (!v)
+      continue;
+    sprintf(buf, "%016llx", v->shape);
+    Array<Cell *> *g = groups.get(buf);
+    if (!g)
+      {
+      g = new Array<Cell *>();
+      groups.add(buf, g);
+      }
+    g->add(order[x]);
+    }
+  out << "// Design " << d->name.name << ": cells with the same structure\n";
+  for (gp = groups.first(); gp; gp++)
+    {
+    Array<Cell *> *g = *gp;
+    if (g->len() > 1)
+      {
+      ++n;
+      out << gp.key() << ':';
+      for (x = 0; x != g->len(); ++x)
+        {
+        out << ' ' << (*g)[x]->name.name;
+        if ((*g)[x]->same)
+          out << '=' << (*g)[x]->same->name.name;
+        }
+      out << '\n';
+      }
+    delete g;
+    }
+  if (!n)
+    out << "// None\n";
+  }
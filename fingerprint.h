@@ -0,0 +1,10 @@
+// Structural fingerprints
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Give each view its structural fingerprint and point each cell which is
+// identical to an earlier one at it (Cell::same).  Only done once.
+void fingerprint(Design *d);
+
+// Write groups of cells with the same fingerprint
+void dups_dump(Design *d, Out& out);
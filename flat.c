@@ -0,0 +1,197 @@
+// Flattened netlist
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "flat.h"
+
+extern int debug;
+
+int flat_leaf(Instance *i)
+  {
+  View *v = i->ref.view;
+  return !v || !i->ref.lib || i->ref.lib->lib_type || v->sim.len();
+  }
+
+// Find net which n was merged into
+
+static FlatNet *flat_find(FlatNet *n)
+  {
+  FlatNet *r, *t;
+  for (r = n; r->same; r = r->same);
+  // Shorten path for next time
+  while (n != r)
+    {
+    t = n->same;
+    n->same = r;
+    n = t;
+    }
+  return r;
+  }
+
+// Merge two nets: the one created first (the one higher up) survives
+
+static FlatNet *flat_merge(FlatNet *a, FlatNet *b)
+  {
+  a = flat_find(a);
+  b = flat_find(b);
+  if (a == b)
+    return a;
+  if (b->id < a->id)
+    {
+    FlatNet *t = a;
+    a = b;
+    b = t;
+    }
+  b->same = a;
+  return a;
+  }
+
+// Flatten view v.  portnets gives the flat net connected to each of
+// v's ports in the parent (or is 0 for the top).  all collects every
+// net created: merged ones get sorted out at the end.
+
+static void flat_view(Flat *f, View *v, string prefix, Hash<FlatNet *> *portnets, Array<FlatNet *>& all)
+  {
+  Hash<FlatInst *> leaves; // Leaf instances of this view by name
+  Hash<Hash<FlatNet *> *> subs; // Port nets of sheet instances by instance name
+  Hash<Instance *>::ptr ip;
+  Hash<Net *>::ptr np;
+
+  for (ip = v->instances.first(); ip; ip++)
+    if (flat_leaf(*ip))
+      {
+      FlatInst *fi = new FlatInst();
+      fi->path = prefix + ip->name.name;
+      fi->inst = *ip;
+      fi->id = f->insts.len();
+      f->insts.add(fi);
+      leaves.add(ip->name.name, fi);
+      }
+    else
+      subs.add(ip->name.name, new Hash<FlatNet *>());
+
+  for (np = v->nets.first(); np; np++)
+    {
+    FlatNet *fn = new FlatNet();
+    Portref *pin;
+    fn->path = prefix + np->name.name;
+    fn->same = 0;
+    fn->id = all.len();
+    all.add(fn);
+    for (pin = np->pins; pin; pin = pin->next)
+      {
+      if (!pin->instance)
+        {
+        // One of our ports: join with net in parent
+        if (!pin->port)
+          continue;
+        if (portnets)
+          {
+          FlatNet *pn = portnets->get(pin->port->name.name);
+          if (pn)
+            flat_merge(pn, fn);
+          }
+        else
+          {
+          FlatPin p;
+          p.inst = 0;
+          p.port = pin->port;
+          p.net = fn;
+          p.pin = 0;
+          fn->pins.add(p);
+          }
+        }
+      else if (FlatInst *fi = leaves.get(pin->instance->name.name))
+        {
+        FlatPin p;
+        p.inst = fi;
+        p.port = pin->port;
+        p.net = fn;
+        p.pin = pin->pin;
+        if (!p.port)
+          continue;
+        fn->pins.add(p);
+        fi->pins.add(p);
+        }
+      else if (Hash<FlatNet *> *sub = subs.get(pin->instance->name.name))
+        {
+        if (pin->port)
+          {
+          FlatNet *o = sub->get(pin->port->name.name);
+          if (o)
+            // Port is on two nets? Should not happen, but keep it connected
+            flat_merge(o, fn);
+          else
+            sub->add(pin->port->name.name, fn);
+          }
+        }
+      }
+    }
+
+  // Descend into sheet instances
+  for (ip = v->instances.first(); ip; ip++)
+    if (!flat_leaf(*ip))
+      {
+      Hash<FlatNet *> *sub = subs.get(ip->name.name);
+      flat_view(f, ip->ref.view, prefix + ip->name.name + "/", sub, all);
+      delete sub;
+      }
+  }
+
+Flat *flatten(Design *d)
+  {
+  Cell *top = find_top(d);
+  Array<FlatNet *> all;
+  int x, y;
+  if (!top || !top->views.first())
+    return 0;
+  Flat *f = new Flat();
+  f->top = top;
+  f->view = *top->views.first();
+  if (debug) cout << "Flattening from " << top->name.name << "\n";
+  flat_view(f, f->view, "", 0, all);
+
+  // Keep surviving nets, move pins of merged nets into them
+  for (x = 0; x != all.len(); ++x)
+    {
+    FlatNet *n = all[x];
+    FlatNet *r = flat_find(n);
+    if (r != n)
+      for (y = 0; y != n->pins.len(); ++y)
+        r->pins.add(n->pins[y]);
+    }
+  for (x = 0; x != all.len(); ++x)
+    {
+    FlatNet *n = all[x];
+    if (!n->same)
+      {
+      for (y = 0; y != n->pins.len(); ++y)
+        n->pins[y].net = n;
+      n->id = f->nets.len();
+      f->nets.add(n);
+      }
+    }
+  // Instance pins still point to pre-merge nets
+  for (x = 0; x != f->insts.len(); ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    for (y = 0; y != fi->pins.len(); ++y)
+      fi->pins[y].net = flat_find(fi->pins[y].net);
+    }
+  for (x = 0; x != all.len(); ++x)
+    if (all[x]->same)
+      delete all[x];
+  return f;
+  }
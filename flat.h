@@ -0,0 +1,55 @@
+// Flattened netlist
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Flattening expands every sheet instance down to its leaves: library
+// parts, sheets with |sim models and broken references.  Nets which
+// are joined through sheet ports become one flat net.
+
+struct FlatInst;
+struct FlatNet;
+
+// A connection between a leaf instance pin (or a top-level port) and a
+// flat net
+
+struct FlatPin
+  {
+  FlatInst *inst; // Leaf instance or 0 for a port of the top cell
+  Port *port; // Port of instance's view or of the top view
+  FlatNet *net;
+  InfPin *pin; // .INF part pin, for its pin number, or 0
+  };
+
+// A leaf instance
+
+struct FlatInst
+  {
+  string path; // Hierarchical name, like SUB1/U1A
+  Instance *inst; // The instance in its own sheet
+  Array<FlatPin> pins; // Connected pins
+  int id; // Position in Flat::insts
+  };
+
+// A flat net
+
+struct FlatNet
+  {
+  string path; // Hierarchical name of topmost piece, like SUB1/MID
+  FlatNet *same; // Net this one was merged into, or 0
+  Array<FlatPin> pins; // Connected pins
+  int id; // Position in Flat::nets
+  };
+
+struct Flat
+  {
+  Cell *top; // Top cell
+  View *view; // Its view
+  Array<FlatInst *> insts; // Leaf instances
+  Array<FlatNet *> nets; // Nets
+  };
+
+// Flatten design from its top cell.  Returns 0 if there is no top cell.
+Flat *flatten(Design *d);
+
+// Return true if instance is a leaf for flattening
+int flat_leaf(Instance *i);
@@ -0,0 +1,153 @@
+// Library part to verilog gate primitive mapping
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdlib.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "gatemap.h"
+
+// Mappings, keyed by lower case library and part name
+
+Hash<GateMap *> gate_maps;
+
+// Verilog gate primitives we know about, and how many outputs they have
+// (0 means all but the last terminal are outputs).
+
+struct GatePrim
+  {
+  const char *name;
+  int noutputs;
+  int min_pins;
+  } gate_prims[] =
+  {
+    { "and", 1, 2 },
+    { "nand", 1, 2 },
+    { "or", 1, 2 },
+    { "nor", 1, 2 },
+    { "xor", 1, 2 },
+    { "xnor", 1, 2 },
+    { "buf", 0, 2 },
+    { "not", 0, 2 },
+    { "bufif0", 1, 3 },
+    { "bufif1", 1, 3 },
+    { "notif0", 1, 3 },
+    { "notif1", 1, 3 },
+    { 0, 0, 0 }
+  };
+
+GateMap::GateMap()
+  {
+  noutputs = 0;
+  bad = 0;
+  }
+
+string gatemap_add(GateMap *g)
+  {
+  int x;
+  for (x = 0; gate_prims[x].name; ++x)
+    if (g->prim == gate_prims[x].name)
+      break;
+  if (!gate_prims[x].name)
+    return "unknown gate primitive " + g->prim;
+  if (g->pins.len() < gate_prims[x].min_pins || (gate_prims[x].min_pins == 3 && g->pins.len() != 3))
+    return "wrong number of pins for " + g->prim;
+  g->noutputs = gate_prims[x].noutputs ? gate_prims[x].noutputs : g->pins.len() - 1;
+  string key = lower(g->library) + " " + lower(g->part);
+  if (gate_maps.get(key))
+    return g->library + " " + g->part + " already mapped";
+  gate_maps.add(key, g);
+  return "";
+  }
+
+void gatemap_load(char *name)
+  {
+  ifstream f;
+  string s;
+  int line = 0;
+  f.open(name, ios::in);
+  if (!f)
+    {
+    cerr << "couldn't open " << name << "\n";
+    exit(-1);
+    }
+  while (getline(f, s))
+    {
+    ++line;
+    if (s.find('#') != string::npos)
+      s.erase(s.find('#'));
+    istringstream in(s);
+    GateMap *g = new GateMap();
+    string pin;
+    if (!(in >> g->library))
+      {
+      delete g;
+      continue;
+      }
+    if (!(in >> g->part >> g->prim))
+      {
+      cerr << name << " " << line << ": Error: expected library part primitive pins...\n";
+      exit(-1);
+      }
+    while (in >> pin)
+      g->pins.add(pin);
+    string err = gatemap_add(g);
+    if (err != "")
+      {
+      cerr << name << " " << line << ": Error: " << err << "\n";
+      exit(-1);
+      }
+    }
+  f.close();
+  }
+
+GateMap *gatemap_find(Cell *c)
+  {
+  if (!gate_maps.len() || !c->mom)
+    return 0;
+  return gate_maps.get(lower(c->mom->name.name) + " " + lower(c->name.name));
+  }
+
+int gatemap_ports(GateMap *g, View *v)
+  {
+  if (g->bad)
+    return 0;
+  if (!g->ports.len())
+    {
+    int x;
+    for (x = 0; x != g->pins.len(); ++x)
+      {
+      Port *p = v->ports.get(g->pins[x]);
+      if (!p)
+        {
+        cerr << "Error: gate map for " << g->library << " " << g->part << ": part has no pin " << g->pins[x] << "\n";
+        g->ports.clear();
+        g->bad = 1;
+        return 0;
+        }
+      g->ports.add(p);
+      }
+    }
+  return 1;
+  }
+
+void gatemap_forget()
+  {
+  Hash<GateMap *>::ptr p;
+  for (p = gate_maps.first(); p; p++)
+    {
+    p->ports.clear();
+    p->bad = 0;
+    }
+  }
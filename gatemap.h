@@ -0,0 +1,37 @@
+// Library part to verilog gate primitive mapping
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// One line of the mapping file:
+//   library part primitive pin1 pin2 ...
+// The pins are the part's pin names in the primitive's terminal order
+// (outputs first), for example:
+//   TTL.LIB 74LS00 nand Y A B
+
+struct GateMap
+  {
+  string library; // Library name, like TTL.LIB
+  string part; // Library part name, like 74LS00
+  string prim; // Verilog gate primitive, like nand
+  Array<string> pins; // Pin names in terminal order
+  Array<Port *> ports; // Pins looked up in the library part (see gatemap_ports)
+  int noutputs; // No. output terminals at the front of pins
+  int bad; // Set if part is missing one of the pins
+  GateMap();
+  };
+
+// Add a mapping: returns error message or ""
+string gatemap_add(GateMap *g);
+
+// Load mapping file.  Exits on error.
+void gatemap_load(char *name);
+
+// Find mapping for a library part, or return 0
+GateMap *gatemap_find(Cell *c);
+
+// Look up ports for mapping in the part's view: returns 0 if some
+// pin is missing.
+int gatemap_ports(GateMap *g, View *v);
+
+// Forget ports looked up by gatemap_ports (when design is deleted)
+void gatemap_forget();
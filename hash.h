@@ -458,7 +458,6 @@ class Hash
     {
     Entry *e = p.p;
     T r = e->val;
-    int idx = e->hv;
     last_idx = -2;
     e->next->prev = e->prev;
     e->prev->next = e->next;
@@ -6,7 +6,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include "string.h"
@@ -16,8 +19,11 @@ using namespace std;
 #include "lisp.h"
 #include "hash.h"
 #include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "net.h"
 #include "inf.h"
+#include "infcache.h"
 
 extern int debug;
 
@@ -67,6 +73,11 @@ const char *tok_names[] =
 	"PIPE"
 };
 
+// Set when a sheet couldn't be loaded: parsing stops and inf_load()
+// fails
+
+static int inf_failed;
+
 // Tokenize .INF file
 
 int ungot_tok = -1;
@@ -126,7 +137,8 @@ int get_tok(const char *name,int& line, istream& in, string& tok_str)
     else
       {
       cerr << name << " " << line << ": Error: Unknown statement\n";
-      exit(-1);
+      inf_failed = 1;
+      return TOK_EOF;
       }
     }
   else if (c == '(')
@@ -174,6 +186,111 @@ int get_tok(const char *name,int& line, istream& in, string& tok_str)
     }
   }
 
+InfPins::InfPins()
+  {
+  pins = 0;
+  npins = 0;
+  refs = 0;
+  iface = HASHVAL_INIT;
+  names = 0;
+  numbers = 0;
+  }
+
+// Pin lists of every instance which is loaded, keyed by their contents
+
+Hash<InfPins *> pin_lists;
+
+// Key is the pin list itself: name, number and type of each pin
+
+static string inf_pins_key(InfPin *pins, int npins)
+  {
+  string key;
+  int x;
+  for (x = 0; x != npins; ++x)
+    {
+    key += pins[x].name;
+    key += '\0';
+    key += pins[x].pin_number;
+    key += '\0';
+    key += (char)pins[x].type;
+    }
+  return key;
+  }
+
+// Return shared pin list with the same pins as the array
+
+InfPins *inf_intern_pins(Array<InfPin>& pins)
+  {
+  InfPins *l;
+  string key = inf_pins_key(pins.len() ? &pins[0] : 0, pins.len());
+  int x;
+  l = pin_lists.get(key);
+  if (!l)
+    {
+    l = new InfPins();
+    l->npins = pins.len();
+    l->pins = pins.copy();
+    for (x = 0; x != pins.len(); ++x)
+      {
+      l->iface = hash_string(pins[x].name, l->iface);
+      l->iface = hash_bytes("", 1, l->iface);
+      l->iface = hash_bytes((char *)&pins[x].type, sizeof(int), l->iface);
+      }
+    pin_lists.add(key, l);
+    }
+  ++l->refs;
+  return l;
+  }
+
+void inf_release_pins(InfPins *l)
+  {
+  if (--l->refs)
+    return;
+  pin_lists.del(inf_pins_key(l->pins, l->npins));
+  delete[] l->pins;
+  delete l->names;
+  delete l->numbers;
+  delete l;
+  }
+
+InfPin *InfPins::find(string name)
+  {
+  if (!names)
+    {
+    int x;
+    names = new Hash<InfPin *>();
+    for (x = 0; x != npins; ++x)
+      names->add(pins[x].name, pins + x);
+    }
+  return names->get(name);
+  }
+
+InfPin *InfPins::find_number(string pin_number)
+  {
+  if (!numbers)
+    {
+    int x;
+    numbers = new Hash<InfPin *>();
+    for (x = 0; x != npins; ++x)
+      numbers->add(pins[x].pin_number, pins + x);
+    }
+  return numbers->get(pin_number);
+  }
+
+InfInstance::InfInstance()
+  {
+  pins = 0;
+  next_section = 0;
+  inst = 0;
+  }
+
+InfJoinItem::InfJoinItem()
+  {
+  type = 0;
+  sheet_number = 0;
+  pin_type = 0;
+  }
+
 struct load_stack
   {
   struct load_stack *next;
@@ -186,10 +303,18 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
   {
   InfDesign *inf = 0;
   string tok_str;
+  Array<InfPin> pins; // Pins of instance being parsed
 
+  ungot_tok = -1; // Last parse may have stopped early
   for (;;)
     {
     int t = get_tok(name, line, in, tok_str);
+    if (!inf && t != TOK_H_HEADER && t != TOK_F_HEADER && t != TOK_EOF)
+      {
+      cerr << name << " " << line << ": Error: expected `H or `F header\n";
+      inf_failed = 1;
+      return inf;
+      }
     switch(t)
       {
       case TOK_H_HEADER: case TOK_F_HEADER:
@@ -248,19 +373,22 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
       case TOK_LPAREN:
         {
         cerr << name << " " << line << ": Error: not expecting ( here\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_RPAREN:
         {
         cerr << name << " " << line << ": Error: not expecting ) here\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_FIELD:
         {
         cerr << name << " " << line << ": Error: not expecting field here\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_LINK:
@@ -357,7 +485,8 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
             t = get_tok(name, line, in, tok_str);
             if (t == TOK_LPAREN)
               {
-              InfPin *p = new InfPin();
+              pins.add(InfPin());
+              InfPin *p = &pins[pins.len() - 1];
               t = get_tok(name, line, in, tok_str); /* Pin name */
               p->name = tok_str;
               t = get_tok(name, line, in, tok_str); /* Pin number */
@@ -382,7 +511,6 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
               else // Huh?
                 p->type = 'I';
               t = get_tok(name, line, in, tok_str); /* Right parenthesis */
-              i->pins.add(p->name, p);
               }
             else
               {
@@ -390,11 +518,12 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
               break;
               }
             }
+          i->pins = inf_intern_pins(pins);
+          pins.clear();
           inf->instances.add(i->name, i);
           }
         else if (tok_str == "C")
           { /* Sheet instance */
-          InfInstance *i = new InfInstance();
           i->type = 'C';
           t = get_tok(name, line, in, tok_str); // Sheet file name
           i->sheet_file_name = tok_str;
@@ -409,7 +538,8 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
             t = get_tok(name, line, in, tok_str);
             if (t == TOK_LPAREN)
               {
-              InfPin *p = new InfPin();
+              pins.add(InfPin());
+              InfPin *p = &pins[pins.len() - 1];
               t = get_tok(name, line, in, tok_str); /* Port name */
               p->name = tok_str;
               t = get_tok(name, line, in, tok_str); /* Direction */
@@ -432,7 +562,6 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
               else // Huh?
                 p->type = 'I';
               t = get_tok(name, line, in, tok_str); /* Right parenthesis */
-              i->pins.add(p->name, p);
               }
             else
               {
@@ -440,12 +569,16 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
               break;
               }
             }
+          i->pins = inf_intern_pins(pins);
+          pins.clear();
           inf->instances.add(i->name, i);
           }
         else
           {
           cerr << name << " " << line << ": Error: Unknown instance type (expecting R or C)\n";
-          exit(-1);
+          delete i;
+          inf_failed = 1;
+          return inf;
           }
         break;
         }
@@ -563,25 +696,29 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
       case TOK_LAYOUT:
         {
         cerr << name << " " << line << ": Error: don't know how to deal with layout\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_TRACE:
         {
         cerr << name << " " << line << ": Error: don't know how to deal with trace\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_VECTOR:
         {
         cerr << name << " " << line << ": Error: don't know how to deal with vector\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_STIMULUS:
         {
         cerr << name << " " << line << ": Error: don't know how to deal with stimulus\n";
-        exit(-1);
+        inf_failed = 1;
+        return inf;
         break;
         }
       case TOK_PIPE:
@@ -608,32 +745,213 @@ InfDesign *inf_load_node(const char* name, int& line, istream& in)
 
 // Load a .INF file
 
-InfDesign *inf_load_1(const char *name)
+InfDesign *inf_load_2(const char *name, istream& f)
   {
   InfDesign *v;
   int c;
-  ifstream f;
   int line = 1;
+  v = inf_load_node(name, line, f);
+  if (inf_failed)
+    return v;
+  while(c = f.get(), c!=-1)
+    if(c == '\n') ++line;
+    else if(c != ' ' && c != '\t' && c != '\r') break;
+  if(c != -1)
+    {
+    cerr << name << ' ' << line << ": Error: extra junk in input\n";
+    inf_failed = 1;
+    }
+  return v;
+  }
+
+// Free parsed sheet
+
+void inf_free(InfDesign *inf)
+  {
+  Hash<InfLink *>::ptr lp;
+  Hash<InfExtern *>::ptr ep;
+  Hash<InfPort *>::ptr pp;
+  Hash<InfSignal *>::ptr sp;
+  Hash<InfInstance *>::ptr ip;
+  Clist<InfJoin *>::ptr jp;
+  Hash<InfPipe *>::ptr qp;
+  Hash<InfLayout *>::ptr kp;
+  Hash<InfTrace *>::ptr tp;
+  Hash<InfVector *>::ptr vp;
+  Hash<InfStimulus *>::ptr wp;
+  if (!inf)
+    return;
+  for (lp = inf->links.first(); lp; lp++)
+    delete *lp;
+  for (ep = inf->externs.first(); ep; ep++)
+    delete *ep;
+  for (pp = inf->ports.first(); pp; pp++)
+    delete *pp;
+  for (sp = inf->signals.first(); sp; sp++)
+    delete *sp;
+  for (ip = inf->instances.first(); ip; ip++)
+    {
+    if (ip->pins)
+      inf_release_pins(ip->pins);
+    delete *ip;
+    }
+  for (jp = inf->joins.first(); jp; jp++)
+    {
+    for (Clist<InfJoinItem *>::ptr i = jp->items.first(); i; i++)
+      delete *i;
+    delete *jp;
+    }
+  for (qp = inf->pipes.first(); qp; qp++)
+    {
+    for (Clist<InfPipeItem *>::ptr i = qp->items.first(); i; i++)
+      delete *i;
+    delete *qp;
+    }
+  for (kp = inf->layouts.first(); kp; kp++)
+    delete *kp;
+  for (tp = inf->traces.first(); tp; tp++)
+    delete *tp;
+  for (vp = inf->vectors.first(); vp; vp++)
+    delete *vp;
+  for (wp = inf->stims.first(); wp; wp++)
+    {
+    for (Hash<InfStimList *>::ptr i = wp->items.first(); i; i++)
+      delete *i;
+    delete *wp;
+    }
+  delete inf;
+  }
+
+// Parse a sheet, or get it from the cache.  Returns 0 for error.
+
+static InfDesign *inf_parse(const char *name)
+  {
+  InfDesign *v;
+  ifstream f;
+  string cache_name;
+  inf_failed = 0;
   f.open(name, ios::in);
   if(!f)
     {
     cerr << "couldn't open " << name << "\n";
-    exit(-1);
+    return 0;
     }
   cout << "Loading " << name << "\n";
-  v = inf_load_node(name, line, f);
-  while(c = f.get(), c!=-1)
-    if(c == '\n') ++line;
-    else if(c != ' ' && c != '\t' && c != '\r') break;
-  if(c != -1)
+  if (inf_cache_dir)
     {
-    cerr << name << ' ' << line << ": Error: extra junk in input - goodbye\n";
-    exit(-1);
+    // Use cached image if we've seen these exact contents before
+    string contents((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+    f.close();
+    cache_name = inf_cache_name(contents);
+    v = inf_cache_load(cache_name);
+    if (v)
+      {
+      if (debug) cout << "  from cache " << cache_name << "\n";
+      return v;
+      }
+    istringstream in(contents);
+    v = inf_load_2(name, in);
     }
-  f.close();
+  else
+    {
+    v = inf_load_2(name, f);
+    f.close();
+    }
+  if (!v && !inf_failed)
+    {
+    cerr << name << ": Error: empty file\n";
+    inf_failed = 1;
+    }
+  if (inf_failed)
+    {
+    inf_free(v);
+    return 0;
+    }
+  if (inf_cache_dir)
+    inf_cache_save(cache_name, v);
   return v;
   }
 
+// Parsed sheets kept for reloading: a sheet is parsed again only if its
+// modification time or size changed.
+
+struct InfKept
+  {
+  time_t mtime;
+  off_t size;
+  InfDesign *inf;
+  };
+
+Hash<InfKept *> inf_kept;
+int inf_keep;
+
+// Sheets parsed again during this load, with what they replaced.  The old
+// parse is still used by the design being replaced: it's freed once the
+// load has worked, or put back if it failed.
+
+struct InfReplaced
+  {
+  string name;
+  InfKept old;
+  };
+
+static Array<InfReplaced> inf_replaced;
+
+static void inf_commit(int worked)
+  {
+  int x;
+  for (x = 0; x != inf_replaced.len(); ++x)
+    {
+    InfReplaced& r = inf_replaced[x];
+    InfKept *k = inf_kept.get(r.name);
+    if (worked)
+      inf_free(r.old.inf);
+    else
+      {
+      inf_free(k->inf);
+      if (r.old.inf)
+        *k = r.old;
+      else
+        delete inf_kept.del(r.name);
+      }
+    }
+  inf_replaced.clear();
+  }
+
+InfDesign *inf_load_1(const char *name)
+  {
+  struct stat st;
+  InfKept *k;
+  if (!inf_keep)
+    return inf_parse(name);
+  if (stat(name, &st))
+    {
+    cerr << "couldn't open " << name << "\n";
+    return 0;
+    }
+  k = inf_kept.get(name);
+  if (k && k->mtime == st.st_mtime && k->size == st.st_size)
+    {
+    if (debug) cout << "Keeping " << name << "\n";
+    return k->inf;
+    }
+  InfReplaced r;
+  r.name = name;
+  r.old.inf = 0;
+  if (k)
+    r.old = *k;
+  else
+    {
+    k = new InfKept();
+    inf_kept.add(name, k);
+    }
+  inf_replaced.add(r);
+  k->mtime = st.st_mtime;
+  k->size = st.st_size;
+  k->inf = inf_parse(name);
+  return k->inf;
+  }
+
 // Dump a loaded .INF file
 // (this is not done)
 
@@ -684,10 +1002,9 @@ void InfDump(InfDesign *inf, ostream& out)
           cout << " ";
         }
       cout << "\n";
-      Hash<InfPin *>::ptr pi;
-      for (pi=i->pins.first();pi;pi++)
+      for (x = 0; x != i->pins->npins; ++x)
         {
-        InfPin *p = *pi;
+        InfPin *p = &i->pins->pins[x];
         cout << "( \"" << p->name << "\" \"" << p->pin_number << "\" " << (char)p->type << " )\n";
         }
       }
@@ -697,12 +1014,12 @@ void InfDump(InfDesign *inf, ostream& out)
     }
 
   // Joins
-  Dlist<InfJoin *>::ptr ji;
+  Clist<InfJoin *>::ptr ji;
   for (ji=inf->joins.first();ji;ji++)
     {
     InfJoin *j = *ji;
     cout << "`J ";
-    Dlist<InfJoinItem *>::ptr ii;
+    Clist<InfJoinItem *>::ptr ii;
     for (ii=j->items.first(); ii; ii++)
       {
       InfJoinItem *i = *ii;
@@ -726,12 +1043,34 @@ void InfDump(InfDesign *inf, ostream& out)
     }
   }
 
-View *create_library_part(Design *design, string library, string library_part_name)
+// Library parts created so far: pins and sheet of the instance which
+// defined each one, keyed by library and part name.
+
+struct InfPartDef
+  {
+  InfPins *pins;
+  string sheet;
+  };
+
+Hash<InfPartDef *> part_defs;
+
+void inf_reset()
+  {
+  while (part_defs.len())
+    delete part_defs.pop();
+  }
+
+// Find or create part in library.  created is set if it's new (so
+// caller should add the pins).  Complain if part was already created
+// with a different set of pins.
+
+View *create_library_part(Design *design, string library, string library_part_name, InfPins *pins, string sheet, int& created)
   {
   // Create part in library
   Lib *li;
   Cell *ce;
   View *vi = 0;
+  created = 0;
   li = design->libraries.get(library);
   if (!li)
     {
@@ -756,15 +1095,41 @@ View *create_library_part(Design *design, string library, string library_part_na
     vi->name.name = "netlist";
     vi->mom = ce;
     ce->views.add("netlist", vi);
+    created = 1;
     }
-  else
+  string key = library + '\0' + library_part_name;
+  InfPartDef *def = part_defs.get(key);
+  if (!def)
+    {
+    def = new InfPartDef();
+    def->pins = pins;
+    def->sheet = sheet;
+    part_defs.add(key, def);
+    }
+  else if (def->pins != pins && def->pins->iface != pins->iface)
     {
-    /* Should check if view matches */
-    vi = 0;
+    cerr << sheet << ": Warning: pins of part " << library << " " << library_part_name << " don't match the ones on sheet " << def->sheet << "\n";
     }
   return vi;
   }
 
+// Port of library part for a pin of one of its instances.  Pins may
+// share a name (GND or NC on connectors): ports were made in pin order, so
+// such a pin's port is found by its position.
+
+static Port *inf_pin_port(View *vi, InfPins *pins, InfPin *pin)
+  {
+  Hash<Port *>::ptr p;
+  int x;
+  if (pins->find(pin->name) != pin && vi->ports.len() == pins->npins)
+    {
+    for (p = vi->ports.first(), x = 0; p && pins->pins + x != pin; p++, ++x);
+    if (p && p->name.name == pin->name)
+      return *p;
+    }
+  return vi->ports.get(pin->name);
+  }
+
 // Convert .INF into netlist
 
 Design *inf_to_net(Design *design, InfDesign *inf)
@@ -797,8 +1162,9 @@ Design *inf_to_net(Design *design, InfDesign *inf)
   /* It already exists */
   if (cell)
     {
-    cerr << "Cell already exists?\n";
-    exit(-1);
+    cerr << inf->name << ": Error: another sheet has this name\n";
+    inf_failed = 1;
+    return design;
     }
   cell = new Cell();
   cell->name.name = inf->name;
@@ -816,7 +1182,7 @@ Design *inf_to_net(Design *design, InfDesign *inf)
   InfPipe *pipe = inf->pipes.get("|sim");
   if (pipe)
     {
-    Dlist<InfPipeItem *>::ptr item;
+    Clist<InfPipeItem *>::ptr item;
     // Copy lines to view
     for (item = pipe->items.first(); item; item++)
       {
@@ -857,6 +1223,7 @@ Design *inf_to_net(Design *design, InfDesign *inf)
         break;
       }
     p->name.name = inf_p->name;
+    p->type = inf_p->type;
     p->mom = view;
     view->ports.add(p->name.name, p);
     if (model)
@@ -875,29 +1242,57 @@ Design *inf_to_net(Design *design, InfDesign *inf)
   // Add instances
   if (!model)
     {
+    // Sections of a package share a refdes: chain them together so that
+    // join items (which give refdes and pin number) can find the section.
+    Hash<InfInstance *> parts;
     Hash<InfInstance *>::ptr ii;
+    for (ii=inf->instances.first(); ii; ii++)
+      ii->next_section = 0; // Sheet may have been converted before
+    for (ii=inf->instances.first(); ii; ii++)
+      {
+      InfInstance *inf_i = *ii;
+      if (inf_i->type == 'R')
+        {
+        InfInstance *head = parts.get(inf_i->name);
+        if (head)
+          {
+          inf_i->next_section = head->next_section;
+          head->next_section = inf_i;
+          }
+        else
+          parts.add(inf_i->name, inf_i);
+        }
+      }
+
     for (ii=inf->instances.first(); ii; ii++)
       {
       InfInstance *inf_i = *ii;
       Instance *i = new Instance();
       i->name.name = inf_i->name;
       i->mom = view;
+      inf_i->inst = i;
+      i->inf = inf_i;
       if (inf_i->type == 'R')
         {
-        // Create new library part (returns 0 if part already exists).
-        // FIXME: it should check if the part matches.
-        View *vi = create_library_part(design, inf_i->library, inf_i->library_part_name);
+        // Give each section its own name if package has more than one
+        if (parts.get(inf_i->name)->next_section)
+          i->name.name += inf_i->sub_part_code;
+
+        // Find or create library part.
+        int created;
+        View *vi = create_library_part(design, inf_i->library, inf_i->library_part_name, inf_i->pins, inf->name, created);
 
         // Add pins to new library part
-        Hash<InfPin *>::ptr pini;
-        for (pini=inf_i->pins.first(); pini; pini++)
+        int x;
+        for (x = 0; x != inf_i->pins->npins; ++x)
           {
-          InfPin *pin = *pini;
-          if (vi)
+          InfPin *pin = &inf_i->pins->pins[x];
+          if (created)
             {
             Port *p = new Port();
             p->mom = vi;
             p->name.name = pin->name;
+            p->type = pin->type;
             switch (pin->type)
               {
               case 'I':
@@ -928,6 +1323,9 @@ Design *inf_to_net(Design *design, InfDesign *inf)
         i->ref.libraryRef = inf_i->library;
         i->ref.cellRef = inf_i->library_part_name;
         i->ref.viewRef = "netlist";
+        i->ref.view = vi;
+        i->ref.cell = vi->mom;
+        i->ref.lib = vi->mom->mom;
 
         view->instances.add(i->name.name, i);
         }
@@ -953,12 +1351,12 @@ Design *inf_to_net(Design *design, InfDesign *inf)
       }
 
     // Add nets
-    Dlist<InfJoin *>::ptr ji;
+    Clist<InfJoin *>::ptr ji;
     int netno = 1;
     for (ji=inf->joins.first(); ji; ji++)
       {
       InfJoin *j = *ji;
-      Dlist<InfJoinItem *>::ptr i;
+      Clist<InfJoinItem *>::ptr i;
       if (debug) cout << "Creating net\n";
       Net *net = new Net(); // Create net
       int prio = 5;
@@ -1016,12 +1414,29 @@ Design *inf_to_net(Design *design, InfDesign *inf)
             break;
             }
           case 'R':
-            { // Primitive port
+            { // Primitive port: given by pin number
             Portref *ref = new Portref();
+            InfInstance *sec;
+            InfPin *pin = 0;
             if (debug) cout << "  PrimPin " << i->name << " of " << i->instance_name << "\n";
-            ref->portRef = i->name;
-            ref->instanceRef = i->instance_name;
-            ref->instance = view->instances.get(ref->instanceRef); // Check for failing reference
+            for (sec = parts.get(i->instance_name); sec; sec = sec->next_section)
+              if ((pin = sec->pins->find_number(i->name)))
+                break;
+            if (pin)
+              {
+              ref->portRef = pin->name;
+              ref->instance = sec->inst;
+              ref->instanceRef = sec->inst->name.name;
+              ref->port = inf_pin_port(sec->inst->ref.view, sec->pins, pin);
+              ref->pin = pin;
+              }
+            else
+              {
+              cerr << inf->name << ": Error: part " << i->instance_name << " has no pin number " << i->name << "\n";
+              ref->portRef = i->name;
+              ref->instanceRef = i->instance_name;
+              ref->instance = view->instances.get(ref->instanceRef);
+              }
             ref->next = net->pins; net->pins = ref;
             break;
             }
@@ -1051,7 +1466,10 @@ Design *inf_to_net(Design *design, InfDesign *inf)
   return design;
   }
 
-void edif_link(Design *d)
+// Link instances to their cells and pins to ports.  Returns -1 if a cell
+// has no netlist view.
+
+int edif_link(Design *d)
   {
   cout << "Linking...\n";
   Lib *lib = d->libraries.get("main");
@@ -1060,7 +1478,7 @@ void edif_link(Design *d)
   if (!lib)
     {
     cout << "Link error, no \"main\" library\n";
-    return;
+    return 0;
     }
   else
     {
@@ -1091,7 +1509,7 @@ void edif_link(Design *d)
             if (!vi)
               {
               cerr << "Link error: Couldn't find view netlist of cell " << ce->name.name << " ???\n";
-              exit(-1);
+              return -1;
               }
             i->ref.lib = li;
             i->ref.cell = ce;
@@ -1118,7 +1536,7 @@ void edif_link(Design *d)
           {
           if (debug) cout << "        Pin " << pin->portRef << " on instance " << pin->instanceRef << "\n";
           Instance *i = pin->instance;
-          if (i && i->ref.view)
+          if (i && i->ref.view && !pin->port)
             {
             if (debug) cout << "      portRef " << pin->portRef << "\n";
             pin->port = i->ref.view->ports.get(pin->portRef);
@@ -1134,6 +1552,7 @@ void edif_link(Design *d)
         }
       }
     }
+  return 0;
   }
 
 void hookup_supplies(Design *d)
@@ -1230,24 +1649,47 @@ Design *inf_load(const char *name)
   {
   Design *d = 0;
   InfDesign *v;
+  Hash<int> loaded; // Sheets already loaded: a sheet may be used many times
+  // Part pins are only checked against other sheets of this design
+  inf_reset();
   loop:
+  loaded[name] = 1;
   cout << "Loading " << name << "\n";
   v = inf_load_1(name);
   if (debug) cout << "Convert inf to net " << name << "\n";
   if (v)
     d = inf_to_net(d, v);
-  if (the_load_stack)
+  if (!v || inf_failed)
+    {
+    // Give up, but don't exit: the server keeps its old design
+    while (the_load_stack)
+      {
+      load_stack *k = the_load_stack;
+      the_load_stack = k->next;
+      delete k;
+      }
+    if (d)
+      design_free(d);
+    inf_commit(0);
+    return 0;
+    }
+  while (the_load_stack)
     {
     load_stack *k = the_load_stack;
     the_load_stack = k->next;
     name = k->name;
-    goto loop;
+    delete k;
+    if (!loaded.get(name))
+      goto loop;
     }
-  if (d)
+  inf_commit(1);
+  if (d && edif_link(d))
     {
-    edif_link(d);
-    hookup_supplies(d);
+    design_free(d);
+    return 0;
     }
+  if (d)
+    hookup_supplies(d);
   return d;
   }
 
@@ -30,6 +30,23 @@ struct InfPin
   int type; // 'I'nput, 'O'utput, 'B'idirectional, 'S'upply, 'P'assive, 'T'hree-state, open-'C'ollector, open-'E'mitter
   };
 
+// Pins of an instance: one array instead of a heap object per pin.  The
+// name and pin-number indexes are only built when somebody looks a pin up.
+// Instances with identical pin lists share one InfPins (see inf_intern_pins).
+
+struct InfPins
+  {
+  InfPin *pins; // Array of pins, in .INF order
+  int npins; // No. pins
+  int refs; // No. instances using it
+  Hashval iface; // Hash of pin names and types (same for every section of a part)
+  Hash<InfPin *> *names; // Name index or 0 if not built yet
+  Hash<InfPin *> *numbers; // Pin-number index or 0 if not built yet
+  InfPin *find(string name); // Look up pin by name
+  InfPin *find_number(string pin_number); // Look up pin by pin number
+  InfPins();
+  };
+
 // An instance
 
 // `I R "part_value" library "library_part_name" absolute_identifier
@@ -43,7 +60,7 @@ struct InfInstance
   string name; // Instance name: part reference designator or child sheet name
   int type; // 'R' for part or sheet-path part, 'C' for child instance
   string absolute_identifier; // Unique hex date/time code
-  Hash<InfPin *> pins; // Pins
+  InfPins *pins; // Pins (shared with other instances with the same pins)
 
   // For part
   string part_value; // Part value, like 47K
@@ -55,6 +72,11 @@ struct InfInstance
 
   // For child sheet (wow- no parameters on child sheets!)
   string sheet_file_name; // File name of child, like ALU.SCH
+
+  // Filled in by inf_to_net
+  InfInstance *next_section; // Next section of the same package (same refdes)
+  Instance *inst; // Instance we were converted into
+  InfInstance();
   };
 
 // A join item (unnamed)
@@ -70,6 +92,7 @@ struct InfJoinItem
     // For part or child sheet: 'I'nput, 'O'utput, 'B'idirectional, 'S'upply, 'P'assive, 'T'hree-state, open-'C'ollector, open-'E'mitter
     // For module ports: 'I'nput, 'O'utput, 'B'idirectional, 'U'nspecified, 'S'upply
     // Not used for signals.
+  InfJoinItem();
   };
 
 // A join: all contained join items are electrically connected
@@ -80,7 +103,7 @@ struct InfJoinItem
 
 struct InfJoin
   {
-  Dlist<InfJoinItem *> items;
+  Clist<InfJoinItem *> items;
   };
 
 // Other sheets of this schematic
@@ -194,7 +217,7 @@ struct InfPipeItem
 struct InfPipe
   {
   string name;
-  Dlist<InfPipeItem *> items;
+  Clist<InfPipeItem *> items;
   };
 
 // `H format_version file_name
@@ -223,7 +246,7 @@ struct InfDesign
   Hash<InfInstance *> instances;
 
   // Joins
-  Dlist<InfJoin *> joins;
+  Clist<InfJoin *> joins;
 
   // Pipe items
   Hash<InfPipe *> pipes;
@@ -255,5 +278,21 @@ struct InfDesign
   string address_line_4;
   };
 
-// Load a .INF file
+// Load a .INF file.  Returns 0 if a sheet couldn't be loaded.
 Design *inf_load(const char *name);
+
+// Free a parsed sheet
+void inf_free(InfDesign *inf);
+
+// Set to keep parsed sheets in memory so that loading again only parses
+// sheets which changed
+extern int inf_keep;
+
+// Return shared pin list with the same pins as the array
+InfPins *inf_intern_pins(Array<InfPin>& pins);
+
+// Drop a use of a shared pin list: it's deleted when nothing uses it
+void inf_release_pins(InfPins *l);
+
+// Forget library parts seen by earlier loads (inf_load does this)
+void inf_reset();
@@ -0,0 +1,363 @@
+// Cache of parsed .INF files
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Each parsed sheet is saved in the cache directory as a compact binary
+// image named after a hash of the .INF file contents.  Since the name
+// depends only on the contents, renaming or moving a sheet doesn't
+// matter, and any edit gives a new name.  Stale images are never
+// reused, they are just left behind.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "inf.h"
+#include "infcache.h"
+#include "outfile.h"
+
+char *inf_cache_dir;
+
+// Bump this whenever InfDesign or the image format changes
+#define INF_CACHE_VERSION "infcache 1"
+
+string inf_cache_name(const string& contents)
+  {
+  char buf[20];
+  Hashval h = hash_string(INF_CACHE_VERSION);
+  h = hash_bytes(contents.data(), contents.length(), h);
+  sprintf(buf, "%016llx", h);
+  return string(inf_cache_dir) + "/" + buf + ".infc";
+  }
+
+// Image writer
+
+struct InfImage
+  {
+  string buf;
+  void num(unsigned int n); // Variable length number
+  void str(const string& s); // Length, then bytes
+  };
+
+void InfImage::num(unsigned int n)
+  {
+  while (n >= 0x80)
+    {
+    buf += (char)(n | 0x80);
+    n >>= 7;
+    }
+  buf += (char)n;
+  }
+
+void InfImage::str(const string& s)
+  {
+  num(s.length());
+  buf += s;
+  }
+
+// Image reader: sets bad and returns zeros if we run off the end
+
+struct InfImageReader
+  {
+  const char *s;
+  const char *end;
+  int bad;
+  unsigned int num();
+  string str();
+  };
+
+unsigned int InfImageReader::num()
+  {
+  unsigned int n = 0;
+  int shift = 0;
+  for (;;)
+    {
+    if (s == end || shift > 28)
+      {
+      bad = 1;
+      return 0;
+      }
+    int c = (unsigned char)*s++;
+    n |= (c & 0x7F) << shift;
+    if (!(c & 0x80))
+      return n;
+    shift += 7;
+    }
+  }
+
+string InfImageReader::str()
+  {
+  unsigned int len = num();
+  if (len > (unsigned int)(end - s))
+    {
+    bad = 1;
+    return "";
+    }
+  string r(s, len);
+  s += len;
+  return r;
+  }
+
+void inf_cache_save(string name, InfDesign *inf)
+  {
+  InfImage im;
+  int x;
+
+  im.str(INF_CACHE_VERSION);
+
+  im.str(inf->name);
+  im.str(inf->ver);
+  im.num(inf->hier);
+  im.str(inf->sheet_number);
+  im.str(inf->total_sheet_number);
+  im.str(inf->sheet_size);
+  im.str(inf->date);
+  im.str(inf->document_number);
+  im.str(inf->revision_code);
+  im.str(inf->title);
+  im.str(inf->organization_name);
+  im.str(inf->address_line_1);
+  im.str(inf->address_line_2);
+  im.str(inf->address_line_3);
+  im.str(inf->address_line_4);
+
+  im.num(inf->links.len());
+  for (Hash<InfLink *>::ptr p = inf->links.first(); p; p++)
+    im.str(p->name);
+
+  im.num(inf->externs.len());
+  for (Hash<InfExtern *>::ptr p = inf->externs.first(); p; p++)
+    im.str(p->name);
+
+  im.num(inf->ports.len());
+  for (Hash<InfPort *>::ptr p = inf->ports.first(); p; p++)
+    {
+    im.num(p->type);
+    im.str(p->name);
+    }
+
+  im.num(inf->signals.len());
+  for (Hash<InfSignal *>::ptr p = inf->signals.first(); p; p++)
+    {
+    im.str(p->name);
+    im.num(p->sheet_number);
+    }
+
+  im.num(inf->instances.len());
+  for (Hash<InfInstance *>::ptr p = inf->instances.first(); p; p++)
+    {
+    InfInstance *i = *p;
+    im.num(i->type);
+    im.str(i->name);
+    im.str(i->absolute_identifier);
+    im.str(i->part_value);
+    im.str(i->library);
+    im.str(i->library_part_name);
+    im.str(i->sub_part_code);
+    for (x = 0; x != 8; ++x)
+      im.str(i->part_field[x]);
+    im.str(i->module_field);
+    im.str(i->sheet_file_name);
+    im.num(i->pins->npins);
+    for (x = 0; x != i->pins->npins; ++x)
+      {
+      im.str(i->pins->pins[x].name);
+      im.str(i->pins->pins[x].pin_number);
+      im.num(i->pins->pins[x].type);
+      }
+    }
+
+  im.num(inf->joins.len());
+  for (Clist<InfJoin *>::ptr p = inf->joins.first(); p; p++)
+    {
+    im.num(p->items.len());
+    for (Clist<InfJoinItem *>::ptr q = p->items.first(); q; q++)
+      {
+      im.num(q->type);
+      im.str(q->instance_name);
+      im.str(q->name);
+      im.num(q->sheet_number);
+      im.num(q->pin_type);
+      }
+    }
+
+  im.num(inf->pipes.len());
+  for (Hash<InfPipe *>::ptr p = inf->pipes.first(); p; p++)
+    {
+    im.str(p->name);
+    im.num(p->items.len());
+    for (Clist<InfPipeItem *>::ptr q = p->items.first(); q; q++)
+      im.str(q->s);
+    }
+
+  // Trailing hash catches truncated images
+  char buf[20];
+  sprintf(buf, "%016llx", hash_string(im.buf));
+  im.buf += buf;
+
+  // write_file() renames a temporary file, so readers never see a
+  // partial image.
+  mkdir(inf_cache_dir, 0777);
+  write_file(name, im.buf);
+  }
+
+InfDesign *inf_cache_load(string name)
+  {
+  string image;
+  char buf[20];
+  int x;
+
+  // Read image
+  ifstream f;
+  f.open(name.c_str(), ios::in | ios::binary);
+  if (!f)
+    return 0;
+  image.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+  f.close();
+
+  // Check trailing hash
+  if (image.length() < 16)
+    return 0;
+  sprintf(buf, "%016llx", hash_bytes(image.data(), image.length() - 16));
+  if (image.compare(image.length() - 16, 16, buf))
+    return 0;
+
+  InfImageReader im;
+  im.s = image.data();
+  im.end = image.data() + image.length() - 16;
+  im.bad = 0;
+
+  if (im.str() != INF_CACHE_VERSION)
+    return 0;
+
+  InfDesign *inf = new InfDesign();
+  inf->name = im.str();
+  inf->ver = im.str();
+  inf->hier = im.num();
+  inf->sheet_number = im.str();
+  inf->total_sheet_number = im.str();
+  inf->sheet_size = im.str();
+  inf->date = im.str();
+  inf->document_number = im.str();
+  inf->revision_code = im.str();
+  inf->title = im.str();
+  inf->organization_name = im.str();
+  inf->address_line_1 = im.str();
+  inf->address_line_2 = im.str();
+  inf->address_line_3 = im.str();
+  inf->address_line_4 = im.str();
+
+  int n;
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfLink *l = new InfLink();
+    l->name = im.str();
+    inf->links.add(l->name, l);
+    }
+
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfExtern *e = new InfExtern();
+    e->name = im.str();
+    inf->externs.add(e->name, e);
+    }
+
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfPort *p = new InfPort();
+    p->type = im.num();
+    p->name = im.str();
+    inf->ports.add(p->name, p);
+    }
+
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfSignal *s = new InfSignal();
+    s->name = im.str();
+    s->sheet_number = im.num();
+    inf->signals.add(s->name, s);
+    }
+
+  Array<InfPin> pins;
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfInstance *i = new InfInstance();
+    i->type = im.num();
+    i->name = im.str();
+    i->absolute_identifier = im.str();
+    i->part_value = im.str();
+    i->library = im.str();
+    i->library_part_name = im.str();
+    i->sub_part_code = im.str();
+    for (x = 0; x != 8; ++x)
+      i->part_field[x] = im.str();
+    i->module_field = im.str();
+    i->sheet_file_name = im.str();
+    int npins;
+    for (npins = im.num(); npins && !im.bad; --npins)
+      {
+      InfPin p;
+      p.name = im.str();
+      p.pin_number = im.str();
+      p.type = im.num();
+      pins.add(p);
+      }
+    i->pins = inf_intern_pins(pins);
+    pins.clear();
+    inf->instances.add(i->name, i);
+    }
+
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfJoin *j = new InfJoin();
+    int nitems;
+    for (nitems = im.num(); nitems && !im.bad; --nitems)
+      {
+      InfJoinItem *i = new InfJoinItem();
+      i->type = im.num();
+      i->instance_name = im.str();
+      i->name = im.str();
+      i->sheet_number = im.num();
+      i->pin_type = im.num();
+      j->items.add(i);
+      }
+    inf->joins.add(j);
+    }
+
+  for (n = im.num(); n && !im.bad; --n)
+    {
+    InfPipe *p = new InfPipe();
+    p->name = im.str();
+    int nitems;
+    for (nitems = im.num(); nitems && !im.bad; --nitems)
+      {
+      InfPipeItem *i = new InfPipeItem();
+      i->s = im.str();
+      p->items.add(i);
+      }
+    inf->pipes.add(p->name, p);
+    }
+
+  if (im.bad || im.s != im.end)
+    {
+    // Hash matched but contents don't parse: written by a broken version?
+    cerr << "bad cache file " << name << " (ignored)\n";
+    inf_free(inf);
+    return 0;
+    }
+
+  return inf;
+  }
@@ -0,0 +1,15 @@
+// Cache of parsed .INF files
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Directory to keep cached sheets in, or 0 for no cache
+extern char *inf_cache_dir;
+
+// Return cache file name for .INF file contents
+string inf_cache_name(const string& contents);
+
+// Load cached sheet, returns 0 if it's missing or no good
+InfDesign *inf_cache_load(string name);
+
+// Save parsed sheet in cache
+void inf_cache_save(string name, InfDesign *inf);
@@ -0,0 +1,170 @@
+// JSON Lines netlist output
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// One JSON object per line: the design, then for each library its cells,
+// and for each view its ports, instances and nets.  Every object has an
+// "id" and refers to others by id, so no names need to be looked up.
+// IDs are given out in output order, so they only depend on the design.
+//
+// {"type":"design","id":0,"name":"TOP"}
+// {"type":"lib","id":1,"name":"main","external":false}
+// {"type":"cell","id":2,"lib":1,"name":"TOP"}
+// {"type":"view","id":3,"cell":2,"name":"netlist","sim":0}
+// {"type":"port","id":4,"view":3,"name":"A","dir":"in","supply":false,"pin_type":"I"}
+// {"type":"instance","id":5,"view":3,"name":"U1","lib":"TTL.LIB","cell":"74LS00","ref":7}
+// {"type":"net","id":6,"view":3,"name":"N1","pins":[[null,4],[5,9]]}
+//
+// "pin_type" is the .INF pin type of a part pin (I, O, B, T, C, E, P, S
+// or U), or null if there isn't one.
+// "ref" is the id of the referenced view, or null if it's not linked.
+// Net pins are [instance, port] pairs: instance is null for ports of the
+// view itself, and port is null if it's not linked.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+#include "jsonl.h"
+
+// Write string as a JSON string
+
+static void jsonl_string(Out& out, const string& s)
+  {
+  int x, y;
+  char buf[8];
+  out << '"';
+  for (x = y = 0; x != (int)s.length(); ++x)
+    {
+    unsigned char c = s[x];
+    if (c < 0x20 || c == '"' || c == '\\')
+      {
+      out.put(s.data() + y, x - y);
+      y = x + 1;
+      if (c == '"' || c == '\\')
+        {
+        buf[0] = '\\';
+        buf[1] = c;
+        out.put(buf, 2);
+        }
+      else
+        {
+        sprintf(buf, "\\u%04x", c);
+        out.put(buf, 6);
+        }
+      }
+    }
+  out.put(s.data() + y, x - y);
+  out << '"';
+  }
+
+// Write id or null
+
+static void jsonl_id(Out& out, int id)
+  {
+  if (id == -1)
+    out << "null";
+  else
+    out << id;
+  }
+
+static const char *dir_names[] = { "in", "out", "inout" };
+
+// Write one cell.  This only needs the numbers, so once number_design()
+// has run cells can be written in any order or at the same time.
+
+void jsonl_cell(Out& out, Cell *c)
+  {
+  Hash<View *>::ptr vptr;
+  Hash<Port *>::ptr pptr;
+  Hash<Instance *>::ptr iptr;
+  Hash<Net *>::ptr nptr;
+  out << "{\"type\":\"cell\",\"id\":" << c->id << ",\"lib\":" << c->mom->id << ",\"name\":";
+  jsonl_string(out, c->name.name);
+  out << "}\n";
+  for (vptr = c->views.first(); vptr; vptr++)
+    {
+    View *v = *vptr;
+    out << "{\"type\":\"view\",\"id\":" << v->id << ",\"cell\":" << c->id << ",\"name\":";
+    jsonl_string(out, v->name.name);
+    out << ",\"sim\":" << v->sim.len() << "}\n";
+    for (pptr = v->ports.first(); pptr; pptr++)
+      {
+      Port *p = *pptr;
+      out << "{\"type\":\"port\",\"id\":" << p->id << ",\"view\":" << v->id << ",\"name\":";
+      jsonl_string(out, p->name.name);
+      out << ",\"dir\":";
+      if (p->direction >= 0 && p->direction <= 2)
+        out << '"' << dir_names[p->direction] << '"';
+      else
+        out << "null";
+      out << ",\"supply\":" << (p->supply ? "true" : "false") << ",\"pin_type\":";
+      if (p->type)
+        out << '"' << (char)p->type << '"';
+      else
+        out << "null";
+      out << "}\n";
+      }
+    for (iptr = v->instances.first(); iptr; iptr++)
+      {
+      Instance *i = *iptr;
+      out << "{\"type\":\"instance\",\"id\":" << i->id << ",\"view\":" << v->id << ",\"name\":";
+      jsonl_string(out, i->name.name);
+      out << ",\"lib\":";
+      jsonl_string(out, i->ref.libraryRef);
+      out << ",\"cell\":";
+      jsonl_string(out, i->ref.cellRef);
+      out << ",\"ref\":";
+      jsonl_id(out, i->ref.view ? i->ref.view->id : -1);
+      out << "}\n";
+      }
+    for (nptr = v->nets.first(); nptr; nptr++)
+      {
+      Net *n = *nptr;
+      Portref *r;
+      out << "{\"type\":\"net\",\"id\":" << n->id << ",\"view\":" << v->id << ",\"name\":";
+      jsonl_string(out, n->name.name);
+      out << ",\"pins\":[";
+      for (r = n->pins; r; r = r->next)
+        {
+        out << '[';
+        jsonl_id(out, r->instance ? r->instance->id : -1);
+        out << ',';
+        jsonl_id(out, r->port ? r->port->id : -1);
+        out << ']';
+        if (r->next)
+          out << ',';
+        }
+      out << "]}\n";
+      }
+    }
+  }
+
+void jsonl_dump(Design *d, Out& out)
+  {
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  number_design(d);
+  out << "{\"type\":\"design\",\"id\":0,\"name\":";
+  jsonl_string(out, d->name.name);
+  out << "}\n";
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    {
+    out << "{\"type\":\"lib\",\"id\":" << lptr->id << ",\"name\":";
+    jsonl_string(out, lptr->name.name);
+    out << ",\"external\":" << (lptr->lib_type ? "true" : "false") << "}\n";
+    for (cptr = lptr->cells.first(); cptr; cptr++)
+      jsonl_cell(out, *cptr);
+    }
+  }
@@ -0,0 +1,9 @@
+// JSON Lines netlist output
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Write one cell with its views (after number_design)
+void jsonl_cell(Out& out, Cell *c);
+
+// Write whole design, one object per line
+void jsonl_dump(Design *d, Out& out);
@@ -0,0 +1,308 @@
+// Levelization of flattened logic
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Puts the leaf instances of the flattened design in an order where each
+// comes after everything which drives its inputs, and gives each net its
+// logic level: the most instances between it and a primary input.
+//
+// The graph has a node for each leaf instance and each flat net.  An
+// instance points to the nets its output pins drive, and a net points to
+// the instances which have input pins on it.  Which pins are which comes
+// from the gate mapping if the part has one, otherwise from the .INF pin
+// type (or the port direction, for other inputs):
+//
+//   O, T, C, E       output: drives its net
+//   B                bidirectional: drives its net, but isn't followed
+//                    through, or every transceiver would be a loop
+//   I                input: the instance's outputs depend on it
+//   P, S, U          not followed
+//
+// Every leaf is taken to be combinational.  Nets which no instance drives
+// (primary inputs, nets driven only by ports of the top cell) are level
+// 0.  An instance is one more than the highest of its input nets, and a
+// net is the highest of the instances driving it.
+//
+// Strongly connected components of the graph (Tarjan's algorithm, with an
+// explicit stack so that long chains don't overflow the real one) are
+// found in one pass, which gives the order and finds combinational loops
+// at the same time.  Each component of more than one node is a loop: its
+// instances and nets all get one level, one more than the highest level
+// coming into the loop from outside.  Everything takes linear time.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "flat.h"
+#include "gatemap.h"
+#include "outfile.h"
+#include "level.h"
+
+int level_pin(FlatPin *p, GateMap *g)
+  {
+  Port *port = p->port;
+  int x;
+  if (g)
+    {
+    for (x = 0; x != g->ports.len(); ++x)
+      if (g->ports[x] == port)
+        return x < g->noutputs ? LEVEL_OUT : LEVEL_IN;
+    return 0;
+    }
+  if (port->type)
+    {
+    if (strchr("OTCEB", port->type))
+      return LEVEL_OUT;
+    if (port->type == 'I')
+      return LEVEL_IN;
+    return 0;
+    }
+  if (port->supply)
+    return 0;
+  return port->direction == 0 ? LEVEL_IN : LEVEL_OUT;
+  }
+
+GateMap *level_map(FlatInst *fi)
+  {
+  Instance *i = fi->inst;
+  GateMap *g;
+  if (i->ref.cell && i->ref.view && (g = gatemap_find(i->ref.cell)) && gatemap_ports(g, i->ref.view))
+    return g;
+  return 0;
+  }
+
+Levels *levelize(Flat *f)
+  {
+  Levels *l = new Levels();
+  int ni = f->insts.len();
+  int n = ni + f->nets.len(); // Instances are nodes 0 - ni-1, nets follow
+  Array<int> first; // Successors of node x are edges[first[x]] to edges[first[x + 1] - 1]
+  Array<int> edges;
+  Array<int> fill;
+  Array<char> roles; // level_pin() of each instance pin, in order
+  int x, y, k;
+
+  // Count successors, then fill them in
+  for (x = 0; x != n + 1; ++x)
+    first.add(0);
+  for (x = 0; x != ni; ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    GateMap *g = level_map(fi);
+    for (y = 0; y != fi->pins.len(); ++y)
+      {
+      int r = level_pin(&fi->pins[y], g);
+      roles.add(r);
+      if (r == LEVEL_OUT)
+        ++first[x + 1];
+      else if (r == LEVEL_IN)
+        ++first[ni + fi->pins[y].net->id + 1];
+      }
+    }
+  for (x = 0; x != n; ++x)
+    first[x + 1] += first[x];
+  for (x = 0; x != n; ++x)
+    fill.add(first[x]);
+  for (x = 0; x != first[n]; ++x)
+    edges.add(0);
+  for (x = 0, k = 0; x != ni; ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    for (y = 0; y != fi->pins.len(); ++y, ++k)
+      {
+      int net = ni + fi->pins[y].net->id;
+      if (roles[k] == LEVEL_OUT)
+        edges[fill[x]++] = net;
+      else if (roles[k] == LEVEL_IN)
+        edges[fill[net]++] = x;
+      }
+    }
+
+  // Tarjan: components come out successors first
+  Array<int> index, low, on; // Visit order, lowest reachable, set if on stack
+  Array<int> stack; // Visited nodes not yet in a component
+  Array<int> path, next; // Depth first path and next edge of each node on it
+  Array<int> comps, starts; // Nodes of each component, and where each starts
+  int sp = 0, pp = 0, count = 0;
+  for (x = 0; x != n; ++x)
+    {
+    index.add(-1);
+    low.add(0);
+    on.add(0);
+    stack.add(0);
+    path.add(0);
+    next.add(0);
+    }
+  for (x = 0; x != n; ++x)
+    if (index[x] == -1)
+      {
+      index[x] = low[x] = count++;
+      stack[sp++] = x;
+      on[x] = 1;
+      path[pp] = x;
+      next[pp++] = first[x];
+      while (pp)
+        {
+        int v = path[pp - 1];
+        if (next[pp - 1] != first[v + 1])
+          {
+          int w = edges[next[pp - 1]++];
+          if (index[w] == -1)
+            {
+            index[w] = low[w] = count++;
+            stack[sp++] = w;
+            on[w] = 1;
+            path[pp] = w;
+            next[pp++] = first[w];
+            }
+          else if (on[w] && index[w] < low[v])
+            low[v] = index[w];
+          }
+        else
+          {
+          if (--pp && low[v] < low[path[pp - 1]])
+            low[path[pp - 1]] = low[v];
+          if (low[v] == index[v])
+            {
+            int w;
+            starts.add(comps.len());
+            do
+              {
+              w = stack[--sp];
+              on[w] = 0;
+              comps.add(w);
+              } while (w != v);
+            }
+          }
+        }
+      }
+  starts.add(comps.len());
+
+  // Components in reverse are in order: levels flow forward from each
+  Array<int> level; // Highest level coming in, then the node's own
+  for (x = 0; x != n; ++x)
+    level.add(0);
+  l->depth = 0;
+  l->loops = 0;
+  for (x = 0; x != ni; ++x)
+    l->inst_loop.add(0);
+  for (x = 0; x != f->nets.len(); ++x)
+    l->net_loop.add(0);
+  for (k = starts.len() - 2; k >= 0; --k)
+    {
+    int a = starts[k], b = starts[k + 1];
+    int lev = 0;
+    int inst = 0;
+    for (x = a; x != b; ++x)
+      {
+      int v = comps[x];
+      if (level[v] > lev)
+        lev = level[v];
+      if (v < ni)
+        inst = 1;
+      }
+    // Lone nets keep the level of their drivers
+    if (inst)
+      ++lev;
+    if (b - a > 1)
+      ++l->loops;
+    for (x = a; x != b; ++x)
+      {
+      int v = comps[x];
+      level[v] = lev;
+      if (b - a > 1)
+        {
+        if (v < ni)
+          l->inst_loop[v] = l->loops;
+        else
+          l->net_loop[v - ni] = l->loops;
+        }
+      if (v < ni)
+        l->order.add(f->insts[v]);
+      }
+    for (x = a; x != b; ++x)
+      for (y = first[comps[x]]; y != first[comps[x] + 1]; ++y)
+        if (level[edges[y]] < lev)
+          level[edges[y]] = lev;
+    if (lev > l->depth)
+      l->depth = lev;
+    }
+  for (x = 0; x != ni; ++x)
+    l->inst_level.add(level[x]);
+  for (x = ni; x != n; ++x)
+    l->net_level.add(level[x]);
+  return l;
+  }
+
+void levels_dump(Design *d, Out& out)
+  {
+  Flat *f = flatten(d);
+  int x;
+  if (!f)
+    {
+    cerr << "couldn't find top cell to flatten\n";
+    exit(-1);
+    }
+  Levels *l = levelize(f);
+
+  // Nets by level, counting sort
+  Array<int> by_level; // Nets at each level, then where each level starts
+  Array<FlatNet *> sorted;
+  for (x = 0; x <= l->depth + 1; ++x)
+    by_level.add(0);
+  for (x = 0; x != f->nets.len(); ++x)
+    ++by_level[l->net_level[x] + 1];
+
+  out << "// Design " << d->name.name << " (flattened): " << f->insts.len() << " leaf instances, " << f->nets.len() << " nets\n";
+  out << "// Depth " << l->depth << ", " << l->loops << " combinational loops\n";
+  out << "// Nets by level:\n";
+  for (x = 0; x <= l->depth; ++x)
+    if (by_level[x + 1])
+      out << "//   " << x << ": " << by_level[x + 1] << '\n';
+
+  for (x = 0; x != l->depth + 1; ++x)
+    by_level[x + 1] += by_level[x];
+  for (x = 0; x != f->nets.len(); ++x)
+    sorted.add(0);
+  for (x = 0; x != f->nets.len(); ++x)
+    sorted[by_level[l->net_level[x]]++] = f->nets[x];
+
+  // Loops: instances, then nets
+  if (l->loops)
+    {
+    Array<Array<string> *> members;
+    for (x = 0; x != l->loops; ++x)
+      members.add(new Array<string>());
+    for (x = 0; x != f->insts.len(); ++x)
+      if (l->inst_loop[x])
+        members[l->inst_loop[x] - 1]->add(f->insts[x]->path);
+    for (x = 0; x != f->nets.len(); ++x)
+      if (l->net_loop[x])
+        members[l->net_loop[x] - 1]->add("net " + f->nets[x]->path);
+    for (x = 0; x != l->loops; ++x)
+      {
+      int y;
+      out << "loop " << x + 1 << ':';
+      for (y = 0; y != members[x]->len(); ++y)
+        out << ' ' << (*members[x])[y];
+      out << '\n';
+      delete members[x];
+      }
+    }
+
+  for (x = 0; x != sorted.len(); ++x)
+    out << l->net_level[sorted[x]->id] << ' ' << sorted[x]->path << '\n';
+  delete l;
+  }
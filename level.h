@@ -0,0 +1,32 @@
+// Levelization of flattened logic
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// What a pin of a leaf instance does (see level_pin)
+
+#define LEVEL_IN 1 // Instance's outputs depend on it
+#define LEVEL_OUT 2 // Drives its net
+
+struct Levels
+  {
+  Array<int> inst_level; // Level of each leaf instance (by FlatInst::id)
+  Array<int> net_level; // Level of each flat net (by FlatNet::id)
+  Array<int> inst_loop; // Loop no. of each instance (from 1), or 0
+  Array<int> net_loop; // Loop no. of each net, or 0
+  Array<FlatInst *> order; // Leaf instances, each after the ones driving it
+  int depth; // Highest level of any net
+  int loops; // No. combinational loops
+  };
+
+// Return LEVEL_IN, LEVEL_OUT or 0 for a pin of a leaf instance.  g is
+// the instance's gate mapping, or 0.
+int level_pin(FlatPin *p, GateMap *g);
+
+// Gate mapping of a leaf instance, or 0
+GateMap *level_map(FlatInst *fi);
+
+// Levelize flattened design
+Levels *levelize(Flat *f);
+
+// Write depth histogram, loops and level of each net
+void levels_dump(Design *d, Out& out);
@@ -14,7 +14,12 @@ using namespace std;
 
 int orcad_edif_bug = 0;
 
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "lisp.h"
+#include "net.h"
 
 Node::Node()
   {
@@ -90,7 +95,7 @@ Node *load_node(char *filename, istream& in, int& line)
         if(c != ')')
           {
           cerr << filename << ' ' << line << ": Error: parenthesis mismatch\n";
-          exit(-1);
+          throw LoadError();
           }
         return new List(first, filename, line);
         }
@@ -168,7 +173,7 @@ Node *lisp_load(char *name)
   if(!f)
     {
     cerr << "couldn't open " << name << "\n";
-    exit(-1);
+    throw LoadError();
     }
   v = load_node(name, f, line);
   while(c = f.get(), c!=-1)
@@ -177,7 +182,7 @@ Node *lisp_load(char *name)
   if(c != -1)
     {
     cerr << name << ' ' << line << ": extra junk in input - goodbye\n";
-    exit(-1);
+    throw LoadError();
     }
   return v;
   }
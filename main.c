@@ -5,16 +5,38 @@
 #include <fstream>
 #include <string>
 #include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 //#include <strstream>
 using namespace std;
 
 #include "lisp.h"
 #include "hash.h"
 #include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "net.h"
 #include "edif.h"
 #include "inf.h"
 #include "verilog.h"
+#include "infcache.h"
+#include "outfile.h"
+#include "gatemap.h"
+#include "jsonl.h"
+#include "pcb.h"
+#include "bom.h"
+#include "stats.h"
+#include "flat.h"
+#include "level.h"
+#include "sim.h"
+#include "erc.h"
+#include "fingerprint.h"
+#include "diff.h"
+#include "vread.h"
+#include "serve.h"
 
 int debug;
 extern int orcad_edif_bug;
@@ -25,18 +47,271 @@ enum {
   VHDL,
   INF,
   EDIF,
-  NET
+  NET,
+  VERILOG_FLAT,
+  VERILOG_PART,
+  JSONL,
+  PCB,
+  BOM,
+  STATS,
+  DUPS,
+  LEVELS,
+  SIM
 };
 
+// Output format names for -ofmt
+
+struct Format
+  {
+  const char *name;
+  int fmt;
+  } formats[] =
+  {
+  { "net", NET },
+  { "verilog", VERILOG },
+  { "verilog_flat", VERILOG_FLAT },
+  { "verilog_part", VERILOG_PART },
+  { "jsonl", JSONL },
+  { "pcb", PCB },
+  { "bom", BOM },
+  { "stats", STATS },
+  { "dups", DUPS },
+  { "levels", LEVELS },
+  { "sim", SIM },
+  { 0, NONE }
+  };
+
+// Requested outputs
+
+struct Output
+  {
+  int fmt;
+  char *path; // Output path or 0 for -opath
+  };
+
 int ifmt = NONE;
-int ofmt = NONE;
+Array<Output> outputs;
 char *in_name;
+int check; // -erc
+
+// Load a design and index it
+
+Design *load_file(char *name)
+  {
+  Design *d;
+  try
+    {
+    switch (ifmt)
+      {
+      case INF:
+        {
+        d = inf_load(name);
+        break;
+        }
+      case EDIF:
+        {
+        d = parse_edif(lisp_load(name));
+        break;
+        }
+      case VERILOG:
+        {
+        d = verilog_load(name);
+        break;
+        }
+      default:
+        {
+        cerr << "input format not supported yet\n";
+        return 0;
+        }
+      }
+    }
+  catch (LoadError)
+    {
+    // Message has been printed
+    return 0;
+    }
+  if (d)
+    index_design(d);
+  return d;
+  }
+
+// Done to each design we write or serve: find identical cells (before
+// outputs are forked so that it's done once) and do the electrical rule
+// check.  Returns -1 if the check found errors.
+
+int prepare(Design *d)
+  {
+  if (verilog_share)
+    fingerprint(d);
+  if (check && erc(d))
+    return -1;
+  return 0;
+  }
+
+// Load input file again for -serve and -query.  Like at startup, a design
+// with ERC errors isn't served.
+
+Design *load()
+  {
+  Design *d = load_file(in_name);
+  if (d && prepare(d))
+    {
+    cerr << "design has ERC errors\n";
+    design_free(d);
+    d = 0;
+    }
+  return d;
+  }
+
+// Load a design from another directory: .INF sub-sheets are found
+// relative to the current directory
+
+Design *load_in_dir(char *name)
+  {
+  char *s = strrchr(name, '/');
+  char *cwd;
+  Design *d;
+  if (!s)
+    return load_file(name);
+  cwd = getcwd(0, 0);
+  string dir(name, s - name);
+  if (chdir(dir == "" ? "/" : dir.c_str()))
+    {
+    cerr << "couldn't change to directory " << dir << "\n";
+    free(cwd);
+    return 0;
+    }
+  d = load_file(s + 1);
+  if (chdir(cwd))
+    {
+    cerr << "couldn't change back to directory " << cwd << "\n";
+    d = 0;
+    }
+  free(cwd);
+  return d;
+  }
+
+// Write output which is one file (or stdout if opath is 0)
+
+// Finish output to stdout.  Returns -1 if a write failed (full disk,
+// closed pipe).
+
+int stdout_done(Out& l)
+  {
+  l.flush();
+  if (l.error)
+    {
+    cerr << "write error\n";
+    return -1;
+    }
+  return 0;
+  }
+
+int emit_file(Design *d, void (*dump)(Design *d, Out& out), char *opath)
+  {
+  if (opath)
+    {
+    int fd = open(opath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1)
+      {
+      cerr << "couldn't open " << opath << "\n";
+      return -1;
+      }
+    Out l(fd);
+    dump(d, l);
+    l.flush();
+    if (l.error || close(fd))
+      {
+      cerr << "close error\n";
+      return -1;
+      }
+    }
+  else
+    {
+    cout.flush();
+    Out l(1);
+    dump(d, l);
+    return stdout_done(l);
+    }
+  return 0;
+  }
+
+// Write one output.  Returns -1 for error.
+
+int emit(Design *d, int fmt, char *opath)
+  {
+  switch (fmt)
+    {
+    case NET:
+      {
+      return emit_file(d, net_dump, opath);
+      }
+    case JSONL:
+      {
+      return emit_file(d, jsonl_dump, opath);
+      }
+    case PCB:
+      {
+      return emit_file(d, pcb_dump, opath);
+      }
+    case BOM:
+      {
+      return emit_file(d, bom_dump, opath);
+      }
+    case STATS:
+      {
+      return emit_file(d, stats_dump, opath);
+      }
+    case DUPS:
+      {
+      return emit_file(d, dups_dump, opath);
+      }
+    case LEVELS:
+      {
+      return emit_file(d, levels_dump, opath);
+      }
+    case SIM:
+      {
+      return emit_file(d, sim_dump, opath);
+      }
+    case VERILOG:
+      {
+      cout.flush();
+      Out l(1);
+      verilog_dump(d, opath, l);
+      return stdout_done(l);
+      }
+    case VERILOG_FLAT:
+      {
+      cout.flush();
+      Out l(1);
+      verilog_flat_dump(d, opath, l);
+      return stdout_done(l);
+      }
+    case VERILOG_PART:
+      {
+      cout.flush();
+      Out l(1);
+      verilog_part_dump(d, opath, l);
+      return stdout_done(l);
+      }
+    default:
+      {
+      cerr << "output format not supported yet\n";
+      return -1;
+      }
+    }
+  }
 
 int main(int argc,char *argv[])
   {
   char *opath = 0;
-  int x;
-  Node *e;
+  char *serve_path = 0;
+  char *query_path = 0;
+  char *diff_name = 0;
+  int x, y;
+  int nfiles;
+  int status;
   Design *d;
   string cmd;
   string s;
@@ -73,28 +348,94 @@ int main(int argc,char *argv[])
       }
     else if (!strcmp(argv[x], "-ofmt"))
       {
-      ++x;
-      if (!strcmp(argv[x], "net"))
-        ofmt = NET;
-      else if (!strcmp(argv[x], "verilog"))
-        ofmt = VERILOG;
-      else
+      // List of formats, each with optional path: verilog=dir,net=file
+      char *p = argv[++x];
+      while (p)
         {
-        cerr << "unknown output format\n";
-        return -1;
+        Output o;
+        char *q = strchr(p, ',');
+        if (q)
+          *q++ = 0;
+        o.path = strchr(p, '=');
+        if (o.path)
+          *o.path++ = 0;
+        for (y = 0; formats[y].name; ++y)
+          if (!strcmp(p, formats[y].name))
+            break;
+        if (!formats[y].name)
+          {
+          cerr << "unknown output format " << p << "\n";
+          return -1;
+          }
+        o.fmt = formats[y].fmt;
+        outputs.add(o);
+        p = q;
         }
       }
     else if (!strcmp(argv[x], "-opath"))
       {
       opath = argv[++x];
       }
+    else if (!strcmp(argv[x], "-cache"))
+      {
+      inf_cache_dir = argv[++x];
+      }
+    else if (!strcmp(argv[x], "-gatemap"))
+      {
+      gatemap_load(argv[++x]);
+      }
+    else if (!strcmp(argv[x], "-serve"))
+      {
+      serve_path = argv[++x];
+      }
+    else if (!strcmp(argv[x], "-parts"))
+      {
+      verilog_parts = atoi(argv[++x]);
+      if (verilog_parts < 1)
+        {
+        cerr << "bad number of parts\n";
+        return -1;
+        }
+      }
+    else if (!strcmp(argv[x], "-stim"))
+      {
+      sim_stimulus = argv[++x];
+      }
+    else if (!strcmp(argv[x], "-diff"))
+      {
+      diff_name = argv[++x];
+      }
+    else if (!strcmp(argv[x], "-share"))
+      {
+      verilog_share = 1;
+      }
+    else if (!strcmp(argv[x], "-erc"))
+      {
+      check = 1;
+      }
+    else if (!strcmp(argv[x], "-query"))
+      {
+      query_path = argv[++x];
+      }
     else if (!strcmp(argv[x], "-h"))
       {
       show_help:
-      cout << "netlist -ifmt [orcad_inf|edif|orcad_edif] -ofmt [net|verilog] name [-opath path]\n";
+      cout << "netlist -ifmt [orcad_inf|edif|orcad_edif|verilog] -ofmt [net|verilog|verilog_flat|verilog_part|jsonl|pcb|bom|stats|dups|levels|sim][=path],... name [-opath path] [-cache dir] [-gatemap file] [-serve socket] [-query file] [-erc] [-share] [-diff old] [-parts n] [-stim file]\n";
       cout << "  Orcad_edif is for edif output from DOS OrCAD which has string escaping bug\n";
-      cout << "  For simple netlist (net) output, -opath gives output file name\n";
+      cout << "  For net, jsonl, pcb, bom, stats, dups, levels and sim output, -opath gives output file name\n";
       cout << "  For verilog output, -opath gives output directory\n";
+      cout << "  For verilog_flat and verilog_part output, -opath gives output file name\n";
+      cout << "  -parts n gives no. parts for verilog_part output (default 2)\n";
+      cout << "  Several formats may be given, each with its own path: -ofmt verilog=dir,net=file\n";
+      cout << "  -opath is the path for formats without one, otherwise output goes to stdout\n";
+      cout << "  -cache keeps parsed .INF files in dir to speed up later runs\n";
+      cout << "  -gatemap file maps library parts to verilog gate primitives\n";
+      cout << "  -stim file gives input vectors for sim output\n";
+      cout << "  -serve socket keeps design loaded and answers requests on Unix socket\n";
+      cout << "  -diff old compares design old with name and writes differences to stdout\n";
+      cout << "  -share writes one verilog module for cells which are identical but for names\n";
+      cout << "  -erc checks for nets with several drivers, undriven inputs and unconnected pins\n";
+      cout << "  -query file answers requests in file (- for stdin) like -serve does\n";
       cout << "  Version 3 - by Joe Allen jhallen@world.std.com\n";
       return 0;
       }
@@ -122,70 +463,74 @@ int main(int argc,char *argv[])
     return -1;
     }
 
-  switch (ifmt)
+  if (ifmt == NONE)
     {
-    case NONE:
-      {
-      cerr << "no input format specified\n";
-      return -1;
-      }
-    case INF:
-      {
-      d = inf_load(in_name);
-      break;
-      }
-    case EDIF:
-      {
-      e = lisp_load(in_name);
-      d = parse_edif(e);
-      break;
-      }
-    default:
-      {
-      cerr << "input format not supported yet\n";
-      return -1;
-      }
+    cerr << "no input format specified\n";
+    return -1;
     }
 
-  switch (ofmt)
+  // Server reloads design: keep parsed sheets so that only changed
+  // ones are parsed again
+  if (serve_path)
+    inf_keep = 1;
+
+  if (diff_name)
     {
-    case NONE:
-      {
-      return 0;
-      }
-    case NET:
-      {
-      if (opath)
-        {
-        fstream l;
-        l.open(opath,ios::out);
-        if (!l)
-          {
-          cerr << "couldn't open " << opath << "\n";
-          return -1;
-          }
-        net_dump(d, l);
-        l.close();
-        if (!l)
-          {
-          cerr << "close error\n";
-          return -1;
-          }
-        return 0;
-        }
-      else
-        net_dump(d, cout);
-      return 0;
-      }
-    case VERILOG:
-      {
-      verilog_dump(d, opath, cout);
-      return 0;
-      }
-    default:
+    // Exit status is like diff's: 0 if same, 1 if different
+    Design *old = load_in_dir(diff_name);
+    d = old ? load_in_dir(in_name) : 0;
+    if (!d)
+      return 2;
+    cout.flush();
+    Out l(1);
+    l << "--- " << diff_name << "\n+++ " << in_name << "\n";
+    x = diff_designs(old, d, l);
+    if (stdout_done(l))
+      return 2;
+    return x ? 1 : 0;
+    }
+
+  d = load_file(in_name);
+  if (!d)
+    return -1;
+
+  // Electrical rule check errors fail the run, but outputs are still
+  // written
+  status = prepare(d);
+
+  // Fill in -opath for outputs without their own path
+  nfiles = 0;
+  for (x = 0; x != outputs.len(); ++x)
+    {
+    if (!outputs[x].path)
+      outputs[x].path = opath;
+    if (outputs[x].path)
+      ++nfiles;
+    }
+
+  // Outputs which go to files don't depend on each other, so when there
+  // are several they are written in parallel by child processes.  Ones
+  // for stdout are written in order by us.
+  cout.flush();
+  for (x = 0; x != outputs.len(); ++x)
+    {
+    pid_t pid = -1;
+    if (nfiles > 1 && outputs[x].path)
       {
-      cerr << "output format not supported yet\n";
-      return -1;
+      pid = fork();
+      if (!pid)
+        exit(emit(d, outputs[x].fmt, outputs[x].path) ? 1 : 0);
       }
+    if (pid == -1 && emit(d, outputs[x].fmt, outputs[x].path))
+      status = -1;
     }
+  int wstatus;
+  while (wait(&wstatus) > 0)
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus))
+      status = -1;
+  if (query_path && !status)
+    status = query(query_path, d, load);
+  if (serve_path && !status)
+    return serve(serve_path, d, load);
+  return status;
   }
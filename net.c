@@ -5,7 +5,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <stdio.h>
 #include <ctype.h>
+#include <string.h>
 
 using namespace std;
 
@@ -13,8 +15,11 @@ extern string legalize_string(string s);
 
 #include "hash.h"
 #include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "lisp.h"
 #include "net.h"
+#include "outfile.h"
 
 string lower(string ss)
   {
@@ -25,6 +30,22 @@ string lower(string ss)
   return s;
   }
 
+Hashval hash_bytes(const char *s, int len, Hashval h)
+  {
+  int x;
+  for (x = 0; x != len; ++x)
+    {
+    h ^= (unsigned char)s[x];
+    h *= 1099511628211ULL;
+    }
+  return h;
+  }
+
+Hashval hash_string(string s, Hashval h)
+  {
+  return hash_bytes(s.data(), s.length(), h);
+  }
+
 Name::Name()
   {
   array = 0;
@@ -35,6 +56,7 @@ Portref::Portref()
   {
   port=0;
   instance=0;
+  pin=0;
   member= -1;
   next=0;
   }
@@ -49,49 +71,260 @@ Viewref::Viewref()
 Design::Design()
   {
   next = 0;
+  used = 0;
+  shaped = 0;
   }
 
 Lib::Lib()
   {
+  id = -1;
   next = 0;
   mom = 0;
   }
 
 Cell::Cell()
   {
+  id = -1;
   next = 0;
   mom = 0;
+  same = 0;
   }
 
 View::View()
   {
+  id = -1;
   next = 0;
   mom = 0;
+  pin_nets = 0;
+  shape = 0;
   }
 
 Port::Port()
   {
+  id = -1;
   mom = 0;
   direction= -1;
   supply = 0;
+  type = 0;
   }
 
 Instance::Instance()
   {
+  id = -1;
+  inf = 0;
   next = 0;
   mom = 0;
   }
 
 Net::Net()
   {
+  id = -1;
   next = 0;
   mom = 0;
   pins = 0;
   }
 
+// Key for pin_nets: port id\0instance id, or just port id\0 for ports of
+// the view.  Ids and not names, because parts can have several pins with
+// one name (GND, NC).  Instance goes last because hval() mostly hashes
+// the end.
+
+static string pin_key(Instance *i, Port *p)
+  {
+  char buf[24];
+  string s;
+  sprintf(buf, "%d", p->id);
+  s = buf;
+  s += '\0';
+  if (i)
+    {
+    sprintf(buf, "%d", i->id);
+    s += buf;
+    }
+  return s;
+  }
+
+// Give every lib, cell, view, port, instance and net its id
+
+void number_design(Design *d)
+  {
+  int id = 1; // Design is 0
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  Hash<View *>::ptr vptr;
+  Hash<Port *>::ptr pptr;
+  Hash<Instance *>::ptr iptr;
+  Hash<Net *>::ptr nptr;
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    {
+    lptr->id = id++;
+    for (cptr = lptr->cells.first(); cptr; cptr++)
+      {
+      cptr->id = id++;
+      for (vptr = cptr->views.first(); vptr; vptr++)
+        {
+        vptr->id = id++;
+        for (pptr = vptr->ports.first(); pptr; pptr++)
+          pptr->id = id++;
+        for (iptr = vptr->instances.first(); iptr; iptr++)
+          iptr->id = id++;
+        for (nptr = vptr->nets.first(); nptr; nptr++)
+          nptr->id = id++;
+        }
+      }
+    }
+  }
+
+void index_design(Design *d)
+  {
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  Hash<View *>::ptr vptr;
+  Hash<Instance *>::ptr iptr;
+  Hash<Net *>::ptr nptr;
+  number_design(d);
+  if (!d->used)
+    d->used = new Hash<Array<Instance *> *>();
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    for (cptr = lptr->cells.first(); cptr; cptr++)
+      for (vptr = cptr->views.first(); vptr; vptr++)
+        {
+        View *v = *vptr;
+        if (v->pin_nets)
+          continue;
+        v->pin_nets = new Hash<Hash<Net *>::ptr>();
+        for (nptr = v->nets.first(); nptr; nptr++)
+          for (Portref *r = nptr->pins; r; r = r->next)
+            // First one wins, like the search it replaces
+            if (r->port && !v->pin_nets->find(pin_key(r->instance, r->port)))
+              v->pin_nets->add(pin_key(r->instance, r->port), nptr);
+        for (iptr = v->instances.first(); iptr; iptr++)
+          if (Cell *c = iptr->ref.cell)
+            {
+            string key = c->mom->name.name + '\0' + c->name.name;
+            Array<Instance *> *l = d->used->get(key);
+            if (!l)
+              {
+              l = new Array<Instance *>();
+              d->used->add(key, l);
+              }
+            l->add(*iptr);
+            }
+        }
+  }
+
+Array<Instance *> *where_used(Design *d, Cell *c)
+  {
+  if (!d->used)
+    index_design(d);
+  return d->used->get(c->mom->name.name + '\0' + c->name.name);
+  }
+
+void design_free(Design *d)
+  {
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  Hash<View *>::ptr vptr;
+  Hash<Port *>::ptr pptr;
+  Hash<Instance *>::ptr iptr;
+  Hash<Net *>::ptr nptr;
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    {
+    for (cptr = lptr->cells.first(); cptr; cptr++)
+      {
+      for (vptr = cptr->views.first(); vptr; vptr++)
+        {
+        for (pptr = vptr->ports.first(); pptr; pptr++)
+          delete *pptr;
+        for (iptr = vptr->instances.first(); iptr; iptr++)
+          delete *iptr;
+        for (nptr = vptr->nets.first(); nptr; nptr++)
+          {
+          Portref *r, *n;
+          for (r = nptr->pins; r; r = n)
+            {
+            n = r->next;
+            delete r;
+            }
+          delete *nptr;
+          }
+        delete vptr->pin_nets;
+        delete *vptr;
+        }
+      delete *cptr;
+      }
+    delete *lptr;
+    }
+  if (d->used)
+    {
+    Hash<Array<Instance *> *>::ptr up;
+    for (up = d->used->first(); up; up++)
+      delete *up;
+    delete d->used;
+    }
+  delete d;
+  }
+
+Cell *find_top(Design *d)
+  {
+  Hash<int> used; // Cells which are instantiated, by library and cell name
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  Hash<View *>::ptr vptr;
+  Hash<Instance *>::ptr iptr;
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    for (cptr = lptr->cells.first(); cptr; cptr++)
+      for (vptr = cptr->views.first(); vptr; vptr++)
+        for (iptr = vptr->instances.first(); iptr; iptr++)
+          if (iptr->ref.cell)
+            used[iptr->ref.cell->mom->name.name + '\0' + iptr->ref.cell->name.name] = 1;
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    if (!lptr->lib_type)
+      for (cptr = lptr->cells.first(); cptr; cptr++)
+        if (!used.get(lptr->name.name + '\0' + cptr->name.name))
+          return *cptr;
+  return 0;
+  }
+
+// Depth-first walk for cell_order(): state is 1 while we're below the
+// cell, 2 once it's in the list.
+
+static void cell_order_1(Cell *c, Hash<int>& state, Array<Cell *>& order)
+  {
+  Hash<View *>::ptr vptr;
+  Hash<Instance *>::ptr iptr;
+  string key = c->mom->name.name + '\0' + c->name.name;
+  if (state.get(key))
+    // Done, or a recursive instance (which we just ignore)
+    return;
+  state[key] = 1;
+  for (vptr = c->views.first(); vptr; vptr++)
+    for (iptr = vptr->instances.first(); iptr; iptr++)
+      {
+      Cell *s = iptr->ref.cell;
+      if (s && !s->mom->lib_type)
+        cell_order_1(s, state, order);
+      }
+  state[key] = 2;
+  order.add(c);
+  }
+
+void cell_order(Design *d, Array<Cell *>& order)
+  {
+  Hash<int> state;
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  for (lptr = d->libraries.first(); lptr; lptr++)
+    if (!lptr->lib_type)
+      for (cptr = lptr->cells.first(); cptr; cptr++)
+        cell_order_1(*cptr, state, order);
+  }
+
 Hash<Net *>::ptr find_net_with_port(View *v, Instance *i, Port *p)
   {
   Hash<Net *>::ptr netptr;
+  if (v->pin_nets)
+    return v->pin_nets->get(pin_key(i, p));
   for(netptr=v->nets.first();netptr;netptr++)
     {
     Net *l= *netptr;
@@ -126,7 +359,7 @@ string find_my_wire(View *v, Instance *i, Port *p)
     return "";
   }
 
-void net_dump(Design *d, ostream& out)
+void net_dump(Design *d, Out& out)
   {
   out << "Design " << d->name.name << '\n';
   Hash<Lib *>::ptr lptr;
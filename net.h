@@ -9,6 +9,9 @@ struct View;
 struct Port;
 struct Instance;
 struct Net;
+struct Out;
+struct InfInstance;
+struct InfPin;
 
 // A name
 
@@ -44,6 +47,7 @@ struct Portref
   int member;				// -1 or 0-n for array reference
   Port *port;				// Linked target
   Instance *instance;			// Linked target
+  InfPin *pin;				// .INF part pin this came from, or 0
   Portref();
   };
 
@@ -54,6 +58,8 @@ struct Design
   Design *next;
   Name name;
   Hash<Lib *> libraries;		// Libraries which make up design
+  Hash<Array<Instance *> *> *used;	// Instances of each cell, by lib\0cell (see index_design)
+  int shaped;				// Set once fingerprint() has been run
   Design();
   };
 
@@ -64,6 +70,7 @@ struct Lib
   Lib *next;
   int lib_type;				// 0 = Design library, 1 = external library
   Name name;
+  int id;				// Number for machine-readable output (see number_design)
   Design *mom;				// Parent
   Hash<Cell *> cells;			// Library is composed of cells
   Lib();
@@ -75,8 +82,11 @@ struct Cell
   {
   Cell *next;
   Name name;
+  string emit_name;
+  int id;
   Lib *mom;				// Parent
   Hash<View *> views;			// Cell is composed of views
+  Cell *same;				// Identical cell found by fingerprint(), or 0
   Cell();
   };
 
@@ -88,11 +98,14 @@ struct View
   {
   View *next;
   Name name;
+  int id;
   Cell *mom;				// Parent
   Hash<Port *> ports;			// Interface
   Hash<Instance *> instances;		// Instances
   Hash<Net *> nets;			// Nets
-  Dlist<string> sim;			// Verilog simulation copy-in text
+  Clist<string> sim;			// Verilog simulation copy-in text
+  Hash<Hash<Net *>::ptr> *pin_nets;	// Net of each instance pin (see index_design)
+  unsigned long long shape;		// Structural fingerprint (see fingerprint.c)
   View();
   };
 
@@ -102,9 +115,11 @@ struct Port
   {
   Name name;
   string emit_name;
+  int id;
   View *mom;
   int direction;	// 0=in, 1=out, 2=inout
   int supply;		// Set if this is a supply pin
+  int type;		// .INF pin type ('I', 'O', 'B', 'T', 'C', 'E', 'P', 'S' or 'U') or 0
   Port();
   };
 
@@ -115,8 +130,10 @@ struct Instance
   Instance *next;
   Name name;
   string emit_name;
+  int id;
   View *mom;				// View we're in
   Viewref ref;				// View we reference
+  InfInstance *inf;			// .INF instance this came from, or 0
   Instance();
   };
 
@@ -127,13 +144,51 @@ struct Net
   Net *next;
   Name name;
   string emit_name;
+  int id;
   View *mom;
   Portref *pins;			// Connected pins
   Net();
   };
 
+// 64-bit FNV-1a hash, for content hashes and signatures
+
+typedef unsigned long long Hashval;
+#define HASHVAL_INIT 14695981039346656037ULL
+Hashval hash_bytes(const char *s, int len, Hashval h = HASHVAL_INIT);
+Hashval hash_string(string s, Hashval h = HASHVAL_INIT);
+
+// Thrown by the EDIF and verilog readers once they have printed an error.
+// load_file() catches it and returns 0, so a server keeps its old design.
+
+struct LoadError
+  {
+  };
+
+// Give every lib, cell, view, port, instance and net its id: numbers
+// are unique in the design, in the order of the hash tables
+void number_design(Design *d);
+
+// Build connectivity indexes: net of each pin for find_net_with_port(),
+// and where each cell is used.  Call when the design is done: they
+// aren't updated when nets change.  Numbers the design (the pin index is
+// by port and instance id).
+void index_design(Design *d);
+
+// Instances of a cell, or 0 if there are none
+Array<Instance *> *where_used(Design *d, Cell *c);
+
+// Delete design and everything in it
+void design_free(Design *d);
+
+// Find top cell: first design cell which no instance refers to
+Cell *find_top(Design *d);
+
+// Put design cells in order so that each comes after every cell it
+// instantiates (leaves first)
+void cell_order(Design *d, Array<Cell *>& order);
+
 string find_my_wire(View *v, Instance *i, Port *p);
 Hash<Net *>::ptr find_net_with_port(View *v, Instance *i, Port *p);
 Portref *find_port_in_net(Net *l, Instance *i, Port *p);
-void net_dump(Design *d, ostream& out);
+void net_dump(Design *d, Out& out);
 string lower(string ss);
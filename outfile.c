@@ -0,0 +1,253 @@
+// Output files
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Flush when this much is queued
+#define OUT_BUF_SIZE (256 * 1024)
+
+Out::Out(int new_fd)
+  {
+  fd = new_fd;
+  error = 0;
+  cur = 0;
+  }
+
+Out::~Out()
+  {
+  if (fd != -1)
+    flush();
+  }
+
+Out &Out::put(const char *s, int len)
+  {
+  if (cur)
+    segs[segs.len() - 1].len += len;
+  else
+    {
+    Seg seg;
+    seg.s = 0;
+    seg.off = buf.length();
+    seg.len = len;
+    segs.add(seg);
+    cur = 1;
+    }
+  buf.append(s, len);
+  if (fd != -1 && buf.length() >= OUT_BUF_SIZE)
+    flush();
+  return *this;
+  }
+
+Out &Out::operator<<(int n)
+  {
+  char tmp[16];
+  char *s = tmp + sizeof(tmp);
+  unsigned int u = n < 0 ? -(unsigned int)n : n;
+  do
+    {
+    *--s = '0' + u % 10;
+    u /= 10;
+    } while (u);
+  if (n < 0)
+    *--s = '-';
+  return put(s, tmp + sizeof(tmp) - s);
+  }
+
+void Out::ref(const string& s)
+  {
+  Seg seg;
+  seg.s = s.data();
+  seg.off = 0;
+  seg.len = s.length();
+  segs.add(seg);
+  cur = 0;
+  }
+
+int Out::len()
+  {
+  int x, n = 0;
+  for (x = 0; x != segs.len(); ++x)
+    n += segs[x].len;
+  return n;
+  }
+
+Hashval Out::hash()
+  {
+  int x;
+  Hashval h = HASHVAL_INIT;
+  for (x = 0; x != segs.len(); ++x)
+    h = hash_bytes(segs[x].s ? segs[x].s : buf.data() + segs[x].off, segs[x].len, h);
+  return h;
+  }
+
+int Out::same(const string& s)
+  {
+  int x;
+  size_t off = 0;
+  if ((size_t)len() != s.length())
+    return 0;
+  for (x = 0; x != segs.len(); ++x)
+    {
+    if (memcmp(segs[x].s ? segs[x].s : buf.data() + segs[x].off, s.data() + off, segs[x].len))
+      return 0;
+    off += segs[x].len;
+    }
+  return 1;
+  }
+
+string Out::str()
+  {
+  int x;
+  string s;
+  s.reserve(len());
+  for (x = 0; x != segs.len(); ++x)
+    s.append(segs[x].s ? segs[x].s : buf.data() + segs[x].off, segs[x].len);
+  return s;
+  }
+
+// Write segs to fd with writev(), IOV_MAX at a time
+
+static int write_segs(int fd, Out& out)
+  {
+  struct iovec iov[IOV_MAX];
+  int x = 0;
+  while (x != out.segs.len())
+    {
+    int n;
+    for (n = 0; n != IOV_MAX && x + n != out.segs.len(); ++n)
+      {
+      Out::Seg *seg = &out.segs[x + n];
+      iov[n].iov_base = (void *)(seg->s ? seg->s : out.buf.data() + seg->off);
+      iov[n].iov_len = seg->len;
+      }
+    int i = 0;
+    while (i != n)
+      {
+      ssize_t len = writev(fd, iov + i, n - i);
+      if (len < 0)
+        return -1;
+      // Skip over what got written
+      while (i != n && (size_t)len >= iov[i].iov_len)
+        len -= iov[i++].iov_len;
+      if (i != n)
+        {
+        iov[i].iov_base = (char *)iov[i].iov_base + len;
+        iov[i].iov_len -= len;
+        }
+      }
+    x += n;
+    }
+  return 0;
+  }
+
+void Out::flush()
+  {
+  if (fd != -1 && segs.len())
+    {
+    if (write_segs(fd, *this))
+      error = 1;
+    buf.clear();
+    segs.clear();
+    cur = 0;
+    }
+  }
+
+// Write to temporary file, then rename it to name
+
+static int write_tmp_file(string name, Out& data)
+  {
+  char buf[20];
+  struct stat st;
+  sprintf(buf, ".%d.tmp", (int)getpid());
+  string tmp = name + buf;
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    {
+    cerr << "couldn't open " << tmp << "\n";
+    return -1;
+    }
+  // Keep permissions of file we're replacing
+  if (!stat(name.c_str(), &st) && fchmod(fd, st.st_mode & 07777))
+    {
+    cerr << "couldn't set permissions of " << tmp << "\n";
+    close(fd);
+    unlink(tmp.c_str());
+    return -1;
+    }
+  if (write_segs(fd, data))
+    {
+    cerr << "write error " << tmp << "\n";
+    close(fd);
+    unlink(tmp.c_str());
+    return -1;
+    }
+  if (close(fd))
+    {
+    cerr << "close error " << tmp << "\n";
+    unlink(tmp.c_str());
+    return -1;
+    }
+  if (rename(tmp.c_str(), name.c_str()))
+    {
+    cerr << "couldn't rename " << tmp << " to " << name << "\n";
+    unlink(tmp.c_str());
+    return -1;
+    }
+  return 0;
+  }
+
+int write_file(string name, const string& data)
+  {
+  Out out(-1);
+  out.ref(data);
+  return write_tmp_file(name, out);
+  }
+
+int update_file(string name, Out& data)
+  {
+  // Compare with what's there now
+  FILE *f = fopen(name.c_str(), "rb");
+  if (f)
+    {
+    string old;
+    char buf[65536];
+    size_t len;
+    int want = data.len();
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+      {
+      old.append(buf, len);
+      if ((int)old.length() > want)
+        break;
+      }
+    fclose(f);
+    if (data.same(old))
+      return 0;
+    }
+  if (write_tmp_file(name, data))
+    return -1;
+  return 1;
+  }
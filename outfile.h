@@ -0,0 +1,60 @@
+// Output files
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Buffered output for all of the netlist writers.  Text is copied into
+// one big buffer and handed to the OS with writev() when it fills up.
+// ref() queues a string without copying it: the string has to stay put
+// until the next flush().  With fd -1 nothing is written: the output
+// stays in memory until it's given to update_file().
+
+struct Out
+  {
+  // A piece of output: either in buf (s == 0) or somebody else's string
+  struct Seg
+    {
+    const char *s;
+    int off; // Offset in buf if s == 0
+    int len;
+    };
+
+  int fd; // File descriptor or -1 for memory
+  int error; // Set if a write failed
+  string buf; // Copied text
+  Array<Seg> segs; // Pieces of output in order
+  int cur; // Set if last seg is in buf (so we can extend it)
+
+  Out &operator<<(const string& s)
+    {
+    return put(s.data(), s.length());
+    }
+  Out &operator<<(const char *s)
+    {
+    return put(s, strlen(s));
+    }
+  Out &operator<<(char c)
+    {
+    return put(&c, 1);
+    }
+  Out &operator<<(int n);
+
+  Out &put(const char *s, int len); // Copy text
+  void ref(const string& s); // Queue string without copying it
+  void flush(); // Write everything queued so far
+  int len(); // No. bytes queued
+  Hashval hash(); // Hash of what's queued
+  int same(const string& s); // Return true if what's queued is s
+  string str(); // Copy of what's queued
+  Out(int new_fd);
+  ~Out();
+  };
+
+// Write data to file: it's written to a temporary file first which is
+// then renamed, so the file is replaced atomically.  A file which is
+// replaced keeps its permissions.  Returns -1 for error.
+int write_file(string name, const string& data);
+
+// Like write_file, but leave file alone (and its modification time) if it
+// already has this data.  Returns 1 if file was written, 0 if it was
+// unchanged, -1 for error.
+int update_file(string name, Out& data);
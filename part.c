@@ -0,0 +1,681 @@
+// Netlist partitioning
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Splits the leaf instances of the flattened design into K parts of about
+// the same size, cutting as few nets as it can.  K parts come from
+// recursive bisection.  Each bisection is multilevel:
+//
+//   Coarsen: instances which share small nets are paired up (heavy edge
+//   matching), giving a smaller netlist of clusters.  This is repeated
+//   until there are only a few clusters.
+//
+//   Split the smallest netlist: grow one side from a random cluster
+//   until it has its share, then improve it.  Best of a few tries.
+//
+//   Uncoarsen: the split is copied back to each bigger netlist in turn
+//   and improved there with Fiduccia-Mattheyses passes.  Each pass moves
+//   every cluster once, best gain first, then backs up to the best cut
+//   it saw.  Moves are kept within the balance limit.
+//
+// Nets with more than PART_BIG pins (clocks, supplies) are cut in any
+// useful partition: they're left out of the cost so that they don't make
+// passes quadratic.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "flat.h"
+#include "part.h"
+
+#define PART_BIG 1000 // Bigger nets don't count in the cost
+#define PART_MATCH 32 // Bigger nets aren't used for pairing instances
+#define PART_COARSEST 128 // Stop coarsening at this many clusters
+#define PART_TRIES 8 // Initial splits to try
+#define PART_PASSES 8 // Max. FM passes per level
+#define PART_SLACK 3 // Balance limit: percent over a part's share
+
+// A netlist as a hypergraph
+
+struct PartGraph
+  {
+  int nv; // No. vertices
+  Array<int> vw; // Vertex weights
+  Array<int> nstart; // Net e has pins npins[nstart[e]] .. npins[nstart[e+1]-1]
+  Array<int> npins;
+  Array<int> vstart; // Vertex v is on nets vnets[vstart[v]] .. vnets[vstart[v+1]-1]
+  Array<int> vnets;
+  int nnets() { return nstart.len() - 1; }
+  };
+
+// Balance limit for each bisection: PART_SLACK is split between the
+// levels of bisection so that it doesn't add up
+
+static double part_slack;
+
+// Repeatable random numbers
+
+static unsigned part_seed;
+
+static int part_rand(int n)
+  {
+  part_seed = part_seed * 1103515245 + 12345;
+  return (part_seed >> 8) % n;
+  }
+
+// Fill array with n copies of val
+
+static void part_fill(Array<int>& a, int n, int val)
+  {
+  int x;
+  a.clear();
+  a.reserve(n);
+  for (x = 0; x != n; ++x)
+    a.add(val);
+  }
+
+// Make vertex to net index once nets are in
+
+static void part_index(PartGraph *g)
+  {
+  int x, y;
+  part_fill(g->vstart, g->nv + 1, 0);
+  for (x = 0; x != g->npins.len(); ++x)
+    g->vstart[g->npins[x] + 1] = g->vstart[g->npins[x] + 1] + 1;
+  for (x = 0; x != g->nv; ++x)
+    g->vstart[x + 1] = g->vstart[x + 1] + g->vstart[x];
+  Array<int> fill;
+  for (x = 0; x != g->nv; ++x)
+    fill.add(g->vstart[x]);
+  part_fill(g->vnets, g->npins.len(), 0);
+  for (x = 0; x != g->nnets(); ++x)
+    for (y = g->nstart[x]; y != g->nstart[x + 1]; ++y)
+      {
+      int v = g->npins[y];
+      g->vnets[fill[v]] = x;
+      fill[v] = fill[v] + 1;
+      }
+  }
+
+// Add net to graph from the pins in l (duplicates already removed).  Nets
+// with one pin can't be cut, so they're left out.
+
+static void part_net(PartGraph *g, Array<int>& l)
+  {
+  int x;
+  if (l.len() < 2)
+    return;
+  for (x = 0; x != l.len(); ++x)
+    g->npins.add(l[x]);
+  g->nstart.add(g->npins.len());
+  }
+
+// Pair up vertices.  map gets cluster of each vertex.
+
+static PartGraph *part_coarsen(PartGraph *g, Array<int>& map, int maxw)
+  {
+  PartGraph *c = new PartGraph();
+  Array<int> order;
+  Array<double> score;
+  Array<int> touched;
+  Array<int> stamp;
+  int x, y, z;
+
+  // Visit vertices in random order
+  for (x = 0; x != g->nv; ++x)
+    order.add(x);
+  for (x = g->nv - 1; x > 0; --x)
+    {
+    int r = part_rand(x + 1);
+    int t = order[x];
+    order[x] = order[r];
+    order[r] = t;
+    }
+
+  part_fill(map, g->nv, -1);
+  for (x = 0; x != g->nv; ++x)
+    score.add(0.0);
+  c->nv = 0;
+  for (x = 0; x != g->nv; ++x)
+    {
+    int v = order[x];
+    int best = -1;
+    if (map[v] != -1)
+      continue;
+    // Score neighbors by how many small nets they share with v
+    touched.clear();
+    for (y = g->vstart[v]; y != g->vstart[v + 1]; ++y)
+      {
+      int e = g->vnets[y];
+      int size = g->nstart[e + 1] - g->nstart[e];
+      if (size > PART_MATCH)
+        continue;
+      for (z = g->nstart[e]; z != g->nstart[e + 1]; ++z)
+        {
+        int u = g->npins[z];
+        if (u != v && map[u] == -1 && g->vw[u] + g->vw[v] <= maxw)
+          {
+          if (score[u] == 0.0)
+            touched.add(u);
+          score[u] = score[u] + 1.0 / (size - 1);
+          }
+        }
+      }
+    for (y = 0; y != touched.len(); ++y)
+      {
+      if (best == -1 || score[touched[y]] > score[best])
+        best = touched[y];
+      }
+    for (y = 0; y != touched.len(); ++y)
+      score[touched[y]] = 0.0;
+    map[v] = c->nv;
+    c->vw.add(g->vw[v]);
+    if (best != -1)
+      {
+      map[best] = c->nv;
+      c->vw[c->nv] = c->vw[c->nv] + g->vw[best];
+      }
+    ++c->nv;
+    }
+
+  // Nets of clusters
+  part_fill(stamp, c->nv, -1);
+  c->nstart.add(0);
+  for (x = 0; x != g->nnets(); ++x)
+    {
+    Array<int> l;
+    for (y = g->nstart[x]; y != g->nstart[x + 1]; ++y)
+      {
+      int u = map[g->npins[y]];
+      if (stamp[u] != x)
+        {
+        stamp[u] = x;
+        l.add(u);
+        }
+      }
+    part_net(c, l);
+    }
+  part_index(c);
+  return c;
+  }
+
+// Fiduccia-Mattheyses refinement of two-way split side[] so that no side
+// goes over maxw (or, if it's over already, gets no bigger).
+
+struct PartFM
+  {
+  PartGraph *g;
+  Array<int> *side;
+  Array<int> cnt[2]; // Pins of each net on each side
+  Array<int> gain;
+  Array<int> locked;
+  Array<int> head[2]; // Gain buckets of each side: head[s][gain + maxg]
+  Array<int> next, prev;
+  int top[2]; // Highest bucket which may be in use
+  int maxg;
+  int minv; // Lightest vertex
+  int w[2]; // Weight of each side
+  int maxw[2];
+
+  // Nets which count
+  int active(int e)
+    {
+    return g->nstart[e + 1] - g->nstart[e] <= PART_BIG;
+    }
+
+  void insert(int v)
+    {
+    int s = (*side)[v];
+    int b = gain[v] + maxg;
+    next[v] = head[s][b];
+    prev[v] = -1;
+    if (next[v] != -1)
+      prev[next[v]] = v;
+    head[s][b] = v;
+    if (b > top[s])
+      top[s] = b;
+    }
+
+  void remove(int v)
+    {
+    int s = (*side)[v];
+    if (prev[v] != -1)
+      next[prev[v]] = next[v];
+    else
+      head[s][gain[v] + maxg] = next[v];
+    if (next[v] != -1)
+      prev[next[v]] = prev[v];
+    }
+
+  void bump(int v, int d)
+    {
+    if (locked[v])
+      return;
+    remove(v);
+    gain[v] = gain[v] + d;
+    insert(v);
+    }
+
+  // How far sides are over their limits
+  int over()
+    {
+    return (w[0] > maxw[0] ? w[0] - maxw[0] : 0) + (w[1] > maxw[1] ? w[1] - maxw[1] : 0);
+    }
+
+  int cut()
+    {
+    int e, n = 0;
+    for (e = 0; e != g->nnets(); ++e)
+      if (active(e) && cnt[0][e] && cnt[1][e])
+        ++n;
+    return n;
+    }
+
+  // Best vertex to move off side s, or -1.  Only the first few in gain
+  // order are looked at: if they're all too heavy, so are most others.
+  int pick(int s)
+    {
+    int b, v, n = 0;
+    int t = 1 - s;
+    if (w[t] + minv > maxw[t] && w[s] <= maxw[s])
+      return -1;
+    while (top[s] >= 0 && head[s][top[s]] == -1)
+      --top[s];
+    for (b = top[s]; b >= 0 && n < 64; --b)
+      for (v = head[s][b]; v != -1 && n < 64; v = next[v], ++n)
+        if (w[t] + g->vw[v] <= maxw[t] || (w[s] > maxw[s] && w[t] + g->vw[v] <= w[s]))
+          return v;
+    return -1;
+    }
+
+  void move(int v)
+    {
+    int f = (*side)[v];
+    int t = 1 - f;
+    int x, y;
+    remove(v);
+    locked[v] = 1;
+    for (x = g->vstart[v]; x != g->vstart[v + 1]; ++x)
+      {
+      int e = g->vnets[x];
+      if (!active(e))
+        continue;
+      if (cnt[t][e] == 0)
+        {
+        for (y = g->nstart[e]; y != g->nstart[e + 1]; ++y)
+          bump(g->npins[y], 1);
+        }
+      else if (cnt[t][e] == 1)
+        {
+        for (y = g->nstart[e]; y != g->nstart[e + 1]; ++y)
+          if ((*side)[g->npins[y]] == t)
+            bump(g->npins[y], -1);
+        }
+      cnt[f][e] = cnt[f][e] - 1;
+      cnt[t][e] = cnt[t][e] + 1;
+      if (cnt[f][e] == 0)
+        {
+        for (y = g->nstart[e]; y != g->nstart[e + 1]; ++y)
+          bump(g->npins[y], -1);
+        }
+      else if (cnt[f][e] == 1)
+        {
+        for (y = g->nstart[e]; y != g->nstart[e + 1]; ++y)
+          if ((*side)[g->npins[y]] == f && g->npins[y] != v)
+            bump(g->npins[y], 1);
+        }
+      }
+    (*side)[v] = t;
+    w[f] -= g->vw[v];
+    w[t] += g->vw[v];
+    }
+
+  // Move back without updating gains (between passes they're redone)
+  void undo(int v)
+    {
+    int f = (*side)[v];
+    int t = 1 - f;
+    int x;
+    for (x = g->vstart[v]; x != g->vstart[v + 1]; ++x)
+      {
+      int e = g->vnets[x];
+      // Like move(): counts of big nets aren't kept
+      if (!active(e))
+        continue;
+      cnt[f][e] = cnt[f][e] - 1;
+      cnt[t][e] = cnt[t][e] + 1;
+      }
+    (*side)[v] = t;
+    w[f] -= g->vw[v];
+    w[t] += g->vw[v];
+    }
+
+  // One pass: returns cut
+  int pass()
+    {
+    int v, x, y;
+    Array<int> moved;
+    int cur = cut();
+    int best = cur, best_over = over(), best_len = 0;
+
+    // Gains and buckets
+    for (v = 0; v != g->nv; ++v)
+      {
+      int s = (*side)[v];
+      int gv = 0;
+      for (x = g->vstart[v]; x != g->vstart[v + 1]; ++x)
+        {
+        int e = g->vnets[x];
+        if (!active(e))
+          continue;
+        if (cnt[s][e] == 1)
+          ++gv;
+        if (cnt[1 - s][e] == 0)
+          --gv;
+        }
+      gain[v] = gv;
+      locked[v] = 0;
+      }
+    for (x = 0; x != 2; ++x)
+      {
+      part_fill(head[x], 2 * maxg + 1, -1);
+      top[x] = -1;
+      }
+    for (v = 0; v != g->nv; ++v)
+      insert(v);
+
+    // Move best vertex until there are none or it's hopeless
+    for (;;)
+      {
+      int a = pick(0), b = pick(1);
+      if (a == -1 && b == -1)
+        break;
+      if (a == -1 || (b != -1 && (gain[b] > gain[a] || (gain[b] == gain[a] && w[1] > w[0]))))
+        v = b;
+      else
+        v = a;
+      cur -= gain[v];
+      move(v);
+      moved.add(v);
+      y = over();
+      if (y < best_over || (y == best_over && cur < best))
+        {
+        best = cur;
+        best_over = y;
+        best_len = moved.len();
+        }
+      else if (moved.len() - best_len > 100 + g->nv / 20)
+        break;
+      }
+
+    // Back up to best
+    for (x = moved.len(); x != best_len; --x)
+      undo(moved[x - 1]);
+    return best;
+    }
+
+  int run(PartGraph *new_g, Array<int> *new_side, int maxw0, int maxw1)
+    {
+    int x, e, v;
+    g = new_g;
+    side = new_side;
+    maxw[0] = maxw0;
+    maxw[1] = maxw1;
+    w[0] = w[1] = 0;
+    for (v = 0; v != g->nv; ++v)
+      w[(*side)[v]] += g->vw[v];
+    for (x = 0; x != 2; ++x)
+      part_fill(cnt[x], g->nnets(), 0);
+    for (e = 0; e != g->nnets(); ++e)
+      for (x = g->nstart[e]; x != g->nstart[e + 1]; ++x)
+        cnt[(*side)[g->npins[x]]][e] = cnt[(*side)[g->npins[x]]][e] + 1;
+    maxg = 0;
+    minv = -1;
+    for (v = 0; v != g->nv; ++v)
+      {
+      if (g->vstart[v + 1] - g->vstart[v] > maxg)
+        maxg = g->vstart[v + 1] - g->vstart[v];
+      if (minv == -1 || g->vw[v] < minv)
+        minv = g->vw[v];
+      }
+    part_fill(gain, g->nv, 0);
+    part_fill(locked, g->nv, 0);
+    part_fill(next, g->nv, -1);
+    part_fill(prev, g->nv, -1);
+    int c = cut(), o = over();
+    for (x = 0; x != PART_PASSES; ++x)
+      {
+      int nc = pass();
+      int no = over();
+      if (no > o || (no == o && nc >= c))
+        break;
+      c = nc;
+      o = no;
+      }
+    return c;
+    }
+  };
+
+// Split smallest graph: grow side 1 from a random vertex until it has
+// its share
+
+static void part_grow(PartGraph *g, Array<int>& side, int share)
+  {
+  Array<int> queue;
+  int w = 0, x, y, q = 0;
+  part_fill(side, g->nv, 0);
+  while (w < share)
+    {
+    int v;
+    if (q == queue.len())
+      {
+      // Start (or restart in another piece) from a random vertex
+      v = part_rand(g->nv);
+      while (side[v])
+        v = (v + 1) % g->nv;
+      side[v] = 1;
+      queue.add(v);
+      w += g->vw[v];
+      continue;
+      }
+    v = queue[q++];
+    for (x = g->vstart[v]; x != g->vstart[v + 1] && w < share; ++x)
+      {
+      int e = g->vnets[x];
+      for (y = g->nstart[e]; y != g->nstart[e + 1] && w < share; ++y)
+        {
+        int u = g->npins[y];
+        if (!side[u])
+          {
+          side[u] = 1;
+          queue.add(u);
+          w += g->vw[u];
+          }
+        }
+      }
+    }
+  }
+
+// Split g in two: side 0 gets about share0 of the weight
+
+static void part_bisect(PartGraph *g, Array<int>& side, int share0)
+  {
+  Array<PartGraph *> graphs;
+  Array<Array<int> *> maps;
+  PartGraph *c = g;
+  PartFM fm;
+  int total = 0, maxv, x, y;
+  for (x = 0; x != g->nv; ++x)
+    total += g->vw[x];
+  int share1 = total - share0;
+  int max0 = share0 + (int)(share0 * part_slack / 100);
+  int max1 = share1 + (int)(share1 * part_slack / 100);
+  maxv = total / (PART_COARSEST / 2) + 1;
+
+  // Coarsen
+  while (c->nv > PART_COARSEST)
+    {
+    Array<int> *map = new Array<int>();
+    PartGraph *n = part_coarsen(c, *map, maxv);
+    if (n->nv > c->nv * 9 / 10)
+      {
+      delete n;
+      delete map;
+      break;
+      }
+    graphs.add(n);
+    maps.add(map);
+    c = n;
+    }
+
+  // Split smallest one: best of a few tries
+  int best_cut = -1, best_over = 0;
+  Array<int> try_side;
+  for (x = 0; x != PART_TRIES; ++x)
+    {
+    int cut, ov;
+    part_grow(c, try_side, share1);
+    cut = fm.run(c, &try_side, max0, max1);
+    ov = fm.over();
+    if (best_cut == -1 || ov < best_over || (ov == best_over && cut < best_cut))
+      {
+      best_cut = cut;
+      best_over = ov;
+      side.clear();
+      for (y = 0; y != try_side.len(); ++y)
+        side.add(try_side[y]);
+      }
+    }
+
+  // Uncoarsen
+  for (x = graphs.len(); x--;)
+    {
+    PartGraph *f = x ? graphs[x - 1] : g;
+    Array<int> fine;
+    for (y = 0; y != f->nv; ++y)
+      fine.add(side[(*maps[x])[y]]);
+    fm.run(f, &fine, max0, max1);
+    side.clear();
+    for (y = 0; y != fine.len(); ++y)
+      side.add(fine[y]);
+    delete graphs[x];
+    delete maps[x];
+    }
+  }
+
+// Split g (whose vertices are ids[] in the original) into k parts
+// numbered from first
+
+static void part_split(PartGraph *g, Array<int>& ids, int k, int first, Array<int>& part)
+  {
+  Array<int> side;
+  int total = 0, x, y, s;
+  if (k == 1 || g->nv < 2)
+    {
+    for (x = 0; x != g->nv; ++x)
+      part[ids[x]] = first;
+    return;
+    }
+  for (x = 0; x != g->nv; ++x)
+    total += g->vw[x];
+  part_bisect(g, side, (int)((long long)total * (k / 2) / k));
+
+  // Recurse on each side
+  for (s = 0; s != 2; ++s)
+    {
+    PartGraph sub;
+    Array<int> sub_ids;
+    Array<int> to_sub; // Vertex number in sub or -1
+    sub.nv = 0;
+    for (x = 0; x != g->nv; ++x)
+      if (side[x] == s)
+        {
+        to_sub.add(sub.nv++);
+        sub.vw.add(g->vw[x]);
+        sub_ids.add(ids[x]);
+        }
+      else
+        to_sub.add(-1);
+    sub.nstart.add(0);
+    for (x = 0; x != g->nnets(); ++x)
+      {
+      Array<int> l;
+      for (y = g->nstart[x]; y != g->nstart[x + 1]; ++y)
+        if (to_sub[g->npins[y]] != -1)
+          l.add(to_sub[g->npins[y]]);
+      part_net(&sub, l);
+      }
+    part_index(&sub);
+    if (s == 0)
+      part_split(&sub, sub_ids, k / 2, first, part);
+    else
+      part_split(&sub, sub_ids, k - k / 2, first + k / 2, part);
+    }
+  }
+
+int partition(Flat *f, int k, Array<int>& part)
+  {
+  PartGraph g;
+  Array<int> ids;
+  Array<int> stamp;
+  int x, y, cut = 0;
+
+  part_seed = 1;
+  for (x = 1, y = 0; x < k; x *= 2)
+    ++y;
+  part_slack = (double)PART_SLACK / (y ? y : 1);
+  g.nv = f->insts.len();
+  for (x = 0; x != g.nv; ++x)
+    {
+    g.vw.add(1);
+    ids.add(x);
+    }
+  part_fill(stamp, g.nv, -1);
+  g.nstart.add(0);
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    Array<int> l;
+    for (y = 0; y != n->pins.len(); ++y)
+      if (n->pins[y].inst && stamp[n->pins[y].inst->id] != x)
+        {
+        stamp[n->pins[y].inst->id] = x;
+        l.add(n->pins[y].inst->id);
+        }
+    part_net(&g, l);
+    }
+  part_index(&g);
+
+  part_fill(part, g.nv, 0);
+  if (k > 1)
+    part_split(&g, ids, k, 0, part);
+
+  // Count all cut nets, big ones too
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    int p = -1;
+    for (y = 0; y != n->pins.len(); ++y)
+      if (n->pins[y].inst)
+        {
+        if (p == -1)
+          p = part[n->pins[y].inst->id];
+        else if (part[n->pins[y].inst->id] != p)
+          {
+          ++cut;
+          break;
+          }
+        }
+    }
+  return cut;
+  }
@@ -0,0 +1,8 @@
+// Netlist partitioning
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Split leaf instances of flattened design into k parts of about the same
+// size with few nets between them.  part gets the part number of each
+// instance (indexed by FlatInst::id).  Returns no. nets which are cut.
+int partition(Flat *f, int k, Array<int>& part);
@@ -0,0 +1,225 @@
+// PCB netlist output
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Writes a flat netlist for PCB layout in Telesis format:
+//
+// $PACKAGES
+// 14PDIP ! 74LS00 ! 74LS00 ; U1 U2
+// $NETS
+// A ; R1.1 U1.1
+// $END
+//
+// Packages come from the module field of each part, pin numbers from the
+// join items of the .INF sheet (pin names aren't unique: a connector may
+// have several GND pins).  Sections of a package (U1A, U1B) are one part.
+// When a sheet is used more than once, its parts would have the same
+// reference designators: those get the path of the sheet instance as a
+// prefix, like SUB1_U1 (parts on the top sheet keep theirs).
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "inf.h"
+#include "flat.h"
+#include "outfile.h"
+#include "pcb.h"
+
+// A physical part
+
+struct PcbPart
+  {
+  string refdes; // Annotated reference designator
+  InfInstance *inf; // One of its sections
+  };
+
+// Parts with the same package, device and value
+
+struct PcbPackage
+  {
+  InfInstance *inf; // For the names
+  Array<string> refdes;
+  };
+
+// Quote name if it has characters which mean something in the netlist
+
+static string pcb_name(const string& s)
+  {
+  int x;
+  if (s.length() && !strpbrk(s.c_str(), " !;,'"))
+    return s;
+  string r = "'";
+  for (x = 0; x != (int)s.length(); ++x)
+    if (s[x] == '\'')
+      r += "''";
+    else
+      r += s[x];
+  return r + "'";
+  }
+
+// Path of sheet instance leaf is in: "SUB1/U1A" gives "SUB1"
+
+static string pcb_parent(const string& path)
+  {
+  int x = path.rfind('/');
+  if (x == (int)string::npos)
+    return "";
+  return path.substr(0, x);
+  }
+
+// Write items separated by spaces, with continuation lines when they get
+// long.
+
+static void pcb_list(Out& out, Array<string>& items)
+  {
+  int x;
+  int col = 0;
+  for (x = 0; x != items.len(); ++x)
+    {
+    if (col > 64)
+      {
+      out << " ,\n ";
+      col = 0;
+      }
+    out << ' ' << items[x];
+    col += items[x].length() + 1;
+    }
+  out << '\n';
+  }
+
+void pcb_dump(Design *d, Out& out)
+  {
+  Flat *f = flatten(d);
+  Hash<PcbPart *> parts; // Parts by sheet instance path and refdes
+  Hash<PcbPart *> first_part; // First part found with each refdes
+  Hash<int> dup; // Set for refdes used in more than one sheet instance
+  Array<PcbPart *> part_of; // Part of each flat instance or 0
+  Hash<PcbPackage *> packages; // Parts by package, device and value
+  Hash<FlatNet *> pin_net; // Net of each refdes.pin
+  Hash<PcbPart *>::ptr pp;
+  Hash<PcbPackage *>::ptr kp;
+  int x, y;
+
+  if (!f)
+    {
+    cerr << "couldn't find top cell\n";
+    exit(-1);
+    }
+
+  // Find parts: part->refdes is the sheet instance path for now
+  for (x = 0; x != f->insts.len(); ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    InfInstance *inf = fi->inst->inf;
+    PcbPart *part = 0;
+    if (!inf || inf->type != 'R')
+      {
+      if (fi->inst->ref.lib && !fi->inst->ref.lib->lib_type)
+        cerr << "Warning: " << fi->path << " has a simulation model: its parts are not in the PCB netlist\n";
+      }
+    else
+      {
+      string parent = pcb_parent(fi->path);
+      string key = parent + '\0' + inf->name;
+      part = parts.get(key);
+      if (!part)
+        {
+        part = new PcbPart();
+        part->refdes = parent;
+        part->inf = inf;
+        parts.add(key, part);
+        PcbPart *first = first_part.get(inf->name);
+        if (!first)
+          first_part.add(inf->name, part);
+        else if (first->refdes != parent)
+          dup[inf->name] = 1;
+        }
+      }
+    part_of.add(part);
+    }
+
+  // Annotate and group by package
+  for (pp = parts.first(); pp; pp++)
+    {
+    PcbPart *part = *pp;
+    if (dup.get(part->inf->name) && part->refdes != "")
+      {
+      string r = part->refdes + "_" + part->inf->name;
+      for (y = 0; y != (int)r.length(); ++y)
+        if (r[y] == '/')
+          r[y] = '_';
+      part->refdes = r;
+      }
+    else
+      part->refdes = part->inf->name;
+    string key = part->inf->module_field + '\0' + part->inf->library_part_name + '\0' + part->inf->part_value;
+    PcbPackage *k = packages.get(key);
+    if (!k)
+      {
+      k = new PcbPackage();
+      k->inf = part->inf;
+      packages.add(key, k);
+      }
+    k->refdes.add(pcb_name(part->refdes));
+    }
+
+  out << "$PACKAGES\n";
+  for (kp = packages.first(); kp; kp++)
+    {
+    out << pcb_name(kp->inf->module_field) << " ! " << pcb_name(kp->inf->library_part_name) << " ! " << pcb_name(kp->inf->part_value) << " ;";
+    pcb_list(out, kp->refdes);
+    }
+
+  out << "$NETS\n";
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    string name = n->path;
+    Array<string> pins;
+    for (y = 0; y != n->pins.len(); ++y)
+      {
+      FlatPin *p = &n->pins[y];
+      if (!p->inst)
+        {
+        // Net with top-level port is named after it
+        name = p->port->name.name;
+        continue;
+        }
+      PcbPart *part = part_of[p->inst->id];
+      if (!part)
+        continue;
+      InfPin *pin = p->pin;
+      if (!pin || pin->pin_number == "")
+        {
+        cerr << "Warning: " << p->inst->path << " pin " << p->port->name.name << " has no pin number\n";
+        continue;
+        }
+      string s = pcb_name(part->refdes + "." + pin->pin_number);
+      // Pins shared by sections (like power) show up once for each
+      FlatNet *o = pin_net.get(s);
+      if (o == n)
+        continue;
+      if (o)
+        cerr << "Warning: pin " << s << " is on nets " << o->path << " and " << n->path << "\n";
+      else
+        pin_net.add(s, n);
+      pins.add(s);
+      }
+    if (pins.len())
+      {
+      out << pcb_name(name) << " ;";
+      pcb_list(out, pins);
+      }
+    }
+  out << "$END\n";
+  }
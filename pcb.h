@@ -0,0 +1,6 @@
+// PCB netlist output
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Write flat Telesis format netlist for PCB layout
+void pcb_dump(Design *d, Out& out);
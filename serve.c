@@ -0,0 +1,334 @@
+// Resident server
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Keeps a linked design in memory and answers requests on a Unix
+// socket, one client at a time.  Or answers requests from a file with
+// -query.  Requests are lines of words:
+//
+//   cells                   List design cells
+//   emit CELL               Verilog module for cell
+//   net CELL NET            Pins on net: "INSTANCE PORT", or "PORT" for
+//                           ports of the cell itself
+//   pins CELL INSTANCE      Nets on instance pins: "PORT NET" ("-" for none)
+//   used CELL               Where cell is used: "CELL INSTANCE"
+//   fanout CELL             Pins on each net, most first: "COUNT NET"
+//   reload                  Load design again: only changed sheets are
+//                           parsed.  If it fails (or has ERC errors, with
+//                           -erc) the old design is kept.
+//   quit                    Close connection
+//   shutdown                Stop the server
+//
+// Each reply ends with a line with just a period.  Reply lines which
+// start with a period get another one in front (like SMTP).  Errors are
+// one line starting with "error: ".
+//
+// Answers come from the indexes made by index_design(), so each one
+// takes time in proportion to its size, not to the size of the cell.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+extern int debug;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+#include "verilog.h"
+#include "gatemap.h"
+#include "serve.h"
+
+static Design *design;
+static Design *(*loader)();
+
+// Find design cell by name, ignoring case if there is no exact match
+
+static Cell *serve_cell(const string& name)
+  {
+  Hash<Lib *>::ptr lptr;
+  Hash<Cell *>::ptr cptr;
+  for (lptr = design->libraries.first(); lptr; lptr++)
+    if (!lptr->lib_type)
+      {
+      Cell *c = lptr->cells.get(name);
+      if (c)
+        return c;
+      for (cptr = lptr->cells.first(); cptr; cptr++)
+        if (lower(cptr->name.name) == lower(name))
+          return *cptr;
+      }
+  return 0;
+  }
+
+// Find cell in any library, for "used"
+
+static Cell *serve_any_cell(const string& name)
+  {
+  Hash<Lib *>::ptr lptr;
+  Cell *c = serve_cell(name);
+  if (!c)
+    for (lptr = design->libraries.first(); lptr; lptr++)
+      if ((c = lptr->cells.get(name)))
+        break;
+  return c;
+  }
+
+// For sorting nets by fan-out
+
+struct Fanout
+  {
+  int count;
+  Net *net;
+  };
+
+static bool fanout_more(const Fanout& a, const Fanout& b)
+  {
+  return a.count > b.count;
+  }
+
+// Send text as reply lines
+
+static void serve_text(Out& out, const string& s)
+  {
+  int x = 0, y;
+  while (x != (int)s.length())
+    {
+    y = s.find('\n', x);
+    if (y == (int)string::npos)
+      y = s.length();
+    else
+      ++y;
+    if (s[x] == '.')
+      out << '.';
+    out.put(s.data() + x, y - x);
+    x = y;
+    }
+  if (x && s[x - 1] != '\n')
+    out << '\n';
+  }
+
+// Handle one request.  Returns 1 to close connection, 2 to stop server.
+
+static int serve_request(Out& out, const string& line)
+  {
+  istringstream in(line);
+  string cmd, a, b;
+  int rtn = 0;
+  in >> cmd >> a >> b;
+  if (debug) cout << "Request: " << line << "\n";
+  if (cmd == "")
+    return 0;
+  else if (cmd == "quit")
+    rtn = 1;
+  else if (cmd == "shutdown")
+    rtn = 2;
+  else if (cmd == "reload")
+    {
+    Design *d = loader();
+    if (d)
+      {
+      gatemap_forget();
+      design_free(design);
+      design = d;
+      out << "reloaded\n";
+      }
+    else
+      out << "error: load failed\n";
+    }
+  else if (cmd == "cells")
+    {
+    Hash<Lib *>::ptr lptr;
+    Hash<Cell *>::ptr cptr;
+    for (lptr = design->libraries.first(); lptr; lptr++)
+      if (!lptr->lib_type)
+        for (cptr = lptr->cells.first(); cptr; cptr++)
+          serve_text(out, cptr->name.name + "\n");
+    }
+  else if (cmd == "used")
+    {
+    Cell *c = serve_any_cell(a);
+    Array<Instance *> *l = c ? where_used(design, c) : 0;
+    int x;
+    if (!c)
+      out << "error: no cell " << a << "\n";
+    else if (l)
+      for (x = 0; x != l->len(); ++x)
+        serve_text(out, (*l)[x]->mom->mom->name.name + " " + (*l)[x]->name.name + "\n");
+    }
+  else if (cmd == "emit" || cmd == "net" || cmd == "pins" || cmd == "fanout")
+    {
+    Cell *c = serve_cell(a);
+    View *v = c ? *c->views.first() : 0;
+    if (!v)
+      out << "error: no cell " << a << "\n";
+    else if (cmd == "emit")
+      {
+      Out m(-1);
+      do_module(m, c, v);
+      serve_text(out, m.str());
+      }
+    else if (cmd == "fanout")
+      {
+      Array<Fanout> l;
+      Hash<Net *>::ptr np;
+      int x;
+      for (np = v->nets.first(); np; np++)
+        {
+        Fanout f;
+        f.count = 0;
+        f.net = *np;
+        for (Portref *r = np->pins; r; r = r->next)
+          ++f.count;
+        l.add(f);
+        }
+      if (l.len())
+        stable_sort(&l[0], &l[0] + l.len(), fanout_more);
+      for (x = 0; x != l.len(); ++x)
+        {
+        ostringstream line;
+        line << l[x].count << " " << l[x].net->name.name << "\n";
+        serve_text(out, line.str());
+        }
+      }
+    else if (cmd == "net")
+      {
+      Net *n = v->nets.get(b);
+      if (!n)
+        out << "error: no net " << b << " in " << c->name.name << "\n";
+      else
+        for (Portref *r = n->pins; r; r = r->next)
+          if (r->instance)
+            serve_text(out, r->instance->name.name + " " + r->portRef + "\n");
+          else
+            serve_text(out, r->portRef + "\n");
+      }
+    else
+      {
+      Instance *i = v->instances.get(b);
+      if (!i)
+        out << "error: no instance " << b << " in " << c->name.name << "\n";
+      else if (!i->ref.view)
+        out << "error: instance " << b << " isn't linked\n";
+      else
+        {
+        Hash<Port *>::ptr pp;
+        for (pp = i->ref.view->ports.first(); pp; pp++)
+          {
+          Hash<Net *>::ptr np = find_net_with_port(v, i, *pp);
+          serve_text(out, pp->name.name + " " + (np ? np->name.name : string("-")) + "\n");
+          }
+        }
+      }
+    }
+  else
+    out << "error: unknown request " << cmd << "\n";
+  out << ".\n";
+  out.flush();
+  return rtn;
+  }
+
+int query(char *path, Design *d, Design *(*load)())
+  {
+  ifstream f;
+  istream *in = &cin;
+  string line;
+  Out out(1);
+  design = d;
+  loader = load;
+  if (strcmp(path, "-"))
+    {
+    f.open(path);
+    if (!f)
+      {
+      cerr << "couldn't open " << path << "\n";
+      return -1;
+      }
+    in = &f;
+    }
+  while (getline(*in, line))
+    {
+    if (line.length() && line[line.length() - 1] == '\r')
+      line.erase(line.length() - 1);
+    if (serve_request(out, line))
+      break;
+    }
+  out.flush();
+  return 0;
+  }
+
+int serve(char *path, Design *d, Design *(*load)())
+  {
+  struct sockaddr_un addr;
+  int s;
+  design = d;
+  loader = load;
+
+  // Clients going away shouldn't kill us
+  signal(SIGPIPE, SIG_IGN);
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    {
+    cerr << "socket name too long: " << path << "\n";
+    return -1;
+    }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  s = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (s == -1 || bind(s, (struct sockaddr *)&addr, sizeof(addr)) || listen(s, 16))
+    {
+    cerr << "couldn't make socket " << path << "\n";
+    return -1;
+    }
+  cout << "Serving on " << path << "\n";
+  cout.flush();
+
+  for (;;)
+    {
+    int c = accept(s, 0, 0);
+    if (c == -1)
+      continue;
+    Out out(c);
+    string buf;
+    char tmp[4096];
+    int len;
+    int rtn = 0;
+    while (!rtn && (len = read(c, tmp, sizeof(tmp))) > 0)
+      {
+      int x;
+      buf.append(tmp, len);
+      while (!rtn && (x = buf.find('\n')) != (int)string::npos)
+        {
+        string line = buf.substr(0, x);
+        buf.erase(0, x + 1);
+        if (line.length() && line[line.length() - 1] == '\r')
+          line.erase(line.length() - 1);
+        rtn = serve_request(out, line);
+        }
+      }
+    out.flush();
+    close(c);
+    if (rtn == 2)
+      break;
+    }
+  close(s);
+  unlink(path);
+  return 0;
+  }
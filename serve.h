@@ -0,0 +1,11 @@
+// Resident server
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Answer requests about design d on Unix socket path until told to stop.
+// load() is called to load the design again.
+int serve(char *path, Design *d, Design *(*load)());
+
+// Answer requests read from file path ("-" for stdin) about design d,
+// replies to stdout.
+int query(char *path, Design *d, Design *(*load)());
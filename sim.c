@@ -0,0 +1,430 @@
+// Bit-parallel simulation of gate mapped designs
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// For designs made only of parts which are mapped to gate primitives
+// (-gatemap).  The flattened design is levelized (see level.c) and
+// compiled into a list of operations in level order, one for each gate.
+// Each flat net has a 64-bit word: bit n is its value in vector n, so one
+// pass over the list evaluates 64 vectors at once with plain word
+// operations.
+//
+// The stimulus file starts with the names of input ports of the top
+// cell, then has one line of 0s and 1s per vector, one for each name
+// (spaces are optional).  Ports which aren't named are 0.  The output has
+// the names of the output ports of the top cell, then a line of their
+// values for each vector.
+//
+// Vectors are independent: every net starts at 0 for each of them.
+// Gates of a combinational loop (like a latch made of two nands) are
+// evaluated over and over until no net in the loop changes.  A loop with
+// more than one stable state (the latch with both inputs inactive) ends
+// up in whichever one the evaluation order reaches from all 0s, not in
+// one it was put in by an earlier vector.
+//
+// Nets driven by bufif and notif gates are the OR of whichever drivers
+// are enabled, and 0 if none are.  Each of these gates keeps what it
+// drives in a word of its own, and the net is made again from all of them
+// whenever one changes, so a net in a loop can go back to 0.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "flat.h"
+#include "gatemap.h"
+#include "outfile.h"
+#include "level.h"
+#include "sim.h"
+
+char *sim_stimulus;
+
+typedef unsigned long long SimWord;
+
+#define SIM_LANES 64
+
+enum
+  {
+  SIM_AND,
+  SIM_OR,
+  SIM_XOR,
+  SIM_BUF,
+  SIM_BUFIF0,
+  SIM_BUFIF1,
+  SIM_LOOP // Repeat next nout operations until nothing changes
+  };
+
+// Operation for each gate primitive
+
+struct SimPrim
+  {
+  const char *name;
+  int op;
+  int invert;
+  } sim_prims[] =
+  {
+    { "and", SIM_AND, 0 },
+    { "nand", SIM_AND, 1 },
+    { "or", SIM_OR, 0 },
+    { "nor", SIM_OR, 1 },
+    { "xor", SIM_XOR, 0 },
+    { "xnor", SIM_XOR, 1 },
+    { "buf", SIM_BUF, 0 },
+    { "not", SIM_BUF, 1 },
+    { "bufif0", SIM_BUFIF0, 0 },
+    { "bufif1", SIM_BUFIF1, 0 },
+    { "notif0", SIM_BUFIF0, 1 },
+    { "notif1", SIM_BUFIF1, 1 },
+    { 0, 0, 0 }
+  };
+
+// One gate: inputs are words args[in] to args[in + nin - 1], outputs
+// follow in the same way
+
+struct SimOp
+  {
+  int op;
+  int invert; // Complement the result (for bufif, the data)
+  int in, nin;
+  int out, nout;
+  int drive; // For bufif: its word in Sim::drives
+  };
+
+struct Sim
+  {
+  Array<SimOp> ops;
+  Array<int> args; // Word numbers
+  Array<SimWord> words; // One per flat net, then zero and sink
+  int zero; // Word which is always 0: for open inputs
+  int sink; // Word for open outputs
+  int unsettled; // No. times a loop didn't settle
+  Array<SimWord> drives; // What each bufif drives
+  Array<int> drive_next; // Next bufif on the same net, or -1
+  Array<int> drive_first; // First bufif driving each word, or -1
+  };
+
+// Evaluate one gate.  Returns true if an output changed.
+
+static int sim_op(Sim *s, SimOp& o)
+  {
+  SimWord *w = &s->words[0];
+  int *a = &s->args[0];
+  SimWord v = w[a[o.in]];
+  int x, changed = 0;
+  switch (o.op)
+    {
+    case SIM_AND:
+      for (x = 1; x != o.nin; ++x)
+        v &= w[a[o.in + x]];
+      break;
+    case SIM_OR:
+      for (x = 1; x != o.nin; ++x)
+        v |= w[a[o.in + x]];
+      break;
+    case SIM_XOR:
+      for (x = 1; x != o.nin; ++x)
+        v ^= w[a[o.in + x]];
+      break;
+    case SIM_BUFIF0: case SIM_BUFIF1:
+      {
+      SimWord en = w[a[o.in + 1]];
+      int d;
+      if (o.op == SIM_BUFIF0)
+        en = ~en;
+      if (o.invert)
+        v = ~v;
+      s->drives[o.drive] = v & en;
+      v = 0;
+      for (d = s->drive_first[a[o.out]]; d != -1; d = s->drive_next[d])
+        v |= s->drives[d];
+      break;
+      }
+    }
+  if (o.invert && o.op != SIM_BUFIF0 && o.op != SIM_BUFIF1)
+    v = ~v;
+  for (x = 0; x != o.nout; ++x)
+    {
+    SimWord& d = w[a[o.out + x]];
+    if (d != v)
+      {
+      d = v;
+      changed = 1;
+      }
+    }
+  return changed;
+  }
+
+// Evaluate all gates once
+
+static void sim_pass(Sim *s)
+  {
+  int pc, x, n;
+  for (pc = 0; pc != s->ops.len(); ++pc)
+    if (s->ops[pc].op == SIM_LOOP)
+      {
+      int changed;
+      int tries = 0;
+      n = s->ops[pc].nout;
+      do
+        {
+        changed = 0;
+        for (x = 1; x <= n; ++x)
+          changed |= sim_op(s, s->ops[pc + x]);
+        } while (changed && ++tries != 2 * n + 8);
+      if (changed)
+        ++s->unsettled;
+      pc += n;
+      }
+    else
+      sim_op(s, s->ops[pc]);
+  }
+
+// Compile gate for flat instance fi.  Returns 0 if it isn't mapped.
+
+static int sim_gate(Sim *s, FlatInst *fi, GateMap *g, Array<int>& drivers)
+  {
+  SimOp o;
+  int x, y;
+  for (x = 0; sim_prims[x].name; ++x)
+    if (g->prim == sim_prims[x].name)
+      break;
+  if (!sim_prims[x].name)
+    return 0;
+  o.op = sim_prims[x].op;
+  o.invert = sim_prims[x].invert;
+  o.out = s->args.len();
+  o.nout = g->noutputs;
+  o.in = o.out + o.nout;
+  o.nin = g->ports.len() - g->noutputs;
+  o.drive = -1;
+  for (x = 0; x != g->ports.len(); ++x)
+    {
+    int word = x < g->noutputs ? s->sink : s->zero;
+    for (y = 0; y != fi->pins.len(); ++y)
+      if (fi->pins[y].port == g->ports[x])
+        {
+        word = fi->pins[y].net->id;
+        if (x < g->noutputs && o.op != SIM_BUFIF0 && o.op != SIM_BUFIF1)
+          ++drivers[word];
+        break;
+        }
+    s->args.add(word);
+    }
+  if (o.op == SIM_BUFIF0 || o.op == SIM_BUFIF1)
+    {
+    // Add to list of drivers of the net (one output)
+    int word = s->args[o.out];
+    o.drive = s->drives.len();
+    s->drives.add(0);
+    s->drive_next.add(s->drive_first[word]);
+    s->drive_first[word] = o.drive;
+    }
+  s->ops.add(o);
+  return 1;
+  }
+
+// Read stimulus header: words of named input ports
+
+static void sim_header(string& line, Hash<int>& inputs, Array<int>& cols)
+  {
+  istringstream in(line);
+  string name;
+  while (in >> name)
+    {
+    Hash<int>::ptr p = inputs.find(name);
+    if (!p)
+      {
+      cerr << sim_stimulus << ": Error: " << name << " is not an input port\n";
+      exit(-1);
+      }
+    cols.add(*p);
+    }
+  }
+
+void sim_dump(Design *d, Out& out)
+  {
+  Flat *f = flatten(d);
+  Sim *s = new Sim();
+  Hash<int> inputs; // Word of each input port
+  Array<string> out_names; // Output ports
+  Array<int> out_words;
+  Array<int> drivers; // No. gates driving each net
+  Array<int> cols; // Word of each stimulus column
+  int x, y, errors = 0;
+
+  if (!f)
+    {
+    cerr << "couldn't find top cell to flatten\n";
+    exit(-1);
+    }
+  if (!sim_stimulus)
+    {
+    cerr << "sim output needs -stim file\n";
+    exit(-1);
+    }
+
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    s->words.add(0);
+    drivers.add(0);
+    }
+  s->zero = s->words.len();
+  s->words.add(0);
+  s->sink = s->words.len();
+  s->words.add(0);
+  s->unsettled = 0;
+  for (x = 0; x != s->words.len(); ++x)
+    s->drive_first.add(-1);
+
+  // Ports of top cell
+  Hash<Port *>::ptr pp;
+  Hash<int> port_word;
+  for (x = 0; x != f->nets.len(); ++x)
+    for (y = 0; y != f->nets[x]->pins.len(); ++y)
+      if (!f->nets[x]->pins[y].inst)
+        port_word.add(f->nets[x]->pins[y].port->name.name, x);
+  for (pp = f->view->ports.first(); pp; pp++)
+    {
+    Hash<int>::ptr w = port_word.find(pp->name.name);
+    if (pp->direction != 1)
+      inputs.add(pp->name.name, w ? *w : s->sink);
+    if (pp->direction != 0)
+      {
+      out_names.add(pp->name.name);
+      out_words.add(w ? *w : s->zero);
+      }
+    }
+
+  // Compile gates in level order, each loop behind a SIM_LOOP
+  Levels *l = levelize(f);
+  for (x = 0; x != l->order.len(); ++x)
+    {
+    FlatInst *fi = l->order[x];
+    GateMap *g = level_map(fi);
+    int loop = l->inst_loop[fi->id];
+    if (loop && (!x || l->inst_loop[l->order[x - 1]->id] != loop))
+      {
+      SimOp o;
+      o.op = SIM_LOOP;
+      o.invert = 0;
+      o.in = o.nin = o.out = 0;
+      o.nout = 0;
+      o.drive = -1;
+      for (y = x; y != l->order.len() && l->inst_loop[l->order[y]->id] == loop; ++y)
+        ++o.nout;
+      s->ops.add(o);
+      }
+    if (g)
+      {
+      if (!sim_gate(s, fi, g, drivers))
+        {
+        cerr << "Error: " << fi->path << ": can't simulate " << g->prim << "\n";
+        ++errors;
+        }
+      }
+    else
+      {
+      // Parts which drive nothing (connectors, resistors) are left out
+      for (y = 0; y != fi->pins.len(); ++y)
+        if (level_pin(&fi->pins[y], 0) == LEVEL_OUT)
+          {
+          cerr << "Error: " << fi->path << ": " << fi->inst->ref.libraryRef << " " << fi->inst->ref.cellRef << " has no gate mapping\n";
+          ++errors;
+          break;
+          }
+      }
+    }
+  for (x = 0; x != f->nets.len(); ++x)
+    if (drivers[x] > 1)
+      {
+      cerr << "Error: net " << f->nets[x]->path << " is driven by " << drivers[x] << " gates\n";
+      ++errors;
+      }
+  if (errors)
+    exit(-1);
+
+  // Run vectors, SIM_LANES at a time
+  ifstream in;
+  string line;
+  int lineno = 0;
+  int header = 0;
+  int n = 0;
+  Array<string> lines; // Lines of this batch, for error messages
+  in.open(sim_stimulus, ios::in);
+  if (!in)
+    {
+    cerr << "couldn't open " << sim_stimulus << "\n";
+    exit(-1);
+    }
+  for (x = 0; x != out_names.len(); ++x)
+    out << (x ? " " : "") << out_names[x];
+  out << '\n';
+  for (;;)
+    {
+    int more = !!getline(in, line);
+    if (more)
+      {
+      ++lineno;
+      if (line.find('#') != string::npos)
+        line.erase(line.find('#'));
+      string bits;
+      for (x = 0; x != (int)line.size(); ++x)
+        if (line[x] != ' ' && line[x] != '\t' && line[x] != '\r')
+          bits += line[x];
+      if (bits.empty())
+        continue;
+      if (!header)
+        {
+        sim_header(line, inputs, cols);
+        header = 1;
+        continue;
+        }
+      if ((int)bits.size() != cols.len() || bits.find_first_not_of("01") != string::npos)
+        {
+        cerr << sim_stimulus << " " << lineno << ": Error: expected " << cols.len() << " 0s and 1s\n";
+        exit(-1);
+        }
+      if (!n)
+        {
+        for (x = 0; x != s->words.len(); ++x)
+          s->words[x] = 0;
+        for (x = 0; x != s->drives.len(); ++x)
+          s->drives[x] = 0;
+        }
+      for (x = 0; x != cols.len(); ++x)
+        if (bits[x] == '1')
+          s->words[cols[x]] |= (SimWord)1 << n;
+      ++n;
+      }
+    if (n == SIM_LANES || (!more && n))
+      {
+      int lane;
+      sim_pass(s);
+      for (lane = 0; lane != n; ++lane)
+        {
+        for (x = 0; x != out_words.len(); ++x)
+          out << (x ? " " : "") << (int)((s->words[out_words[x]] >> lane) & 1);
+        out << '\n';
+        }
+      n = 0;
+      }
+    if (!more)
+      break;
+    }
+  in.close();
+  if (s->unsettled)
+    cerr << "Warning: combinational loops didn't settle " << s->unsettled << " times\n";
+  delete l;
+  delete s;
+  }
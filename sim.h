@@ -0,0 +1,10 @@
+// Bit-parallel simulation of gate mapped designs
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Stimulus file (from -stim)
+extern char *sim_stimulus;
+
+// Simulate flattened design with vectors from sim_stimulus, write
+// output port values for each vector.  Exits on error.
+void sim_dump(Design *d, Out& out);
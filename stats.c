@@ -0,0 +1,267 @@
+// Connectivity statistics
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Report on the shape of the design: for each view and for the whole
+// design, histograms of net fan-out (pins on each net) and of pins per
+// instance (connected pins), then for the design histograms of instances
+// per view, uses of each cell and hierarchy depth, and a list of outlier
+// nets.  Buckets are powers of two: "4-7: 12" means twelve nets (or
+// whatever) have four to seven.
+//
+// The design is not flattened: views are visited once, leaves first
+// (cell_order()), and each design cell's depth and flattened instance
+// count come from those of the cells it instantiates.
+//
+// A net is an outlier if it has at least STATS_BIG pins and more than
+// STATS_RATIO times the average for its view.  These are usually supply
+// nets made by hookup_supplies(): they are marked "supply".
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "outfile.h"
+#include "stats.h"
+
+#define STATS_BIG 64
+#define STATS_RATIO 8
+
+// Histogram with power of two buckets
+
+struct Histogram
+  {
+  Array<int> bins; // bins[0] is for 0, bins[n] for 2^(n-1) to 2^n-1
+  int count; // No. of values
+  long long sum;
+  int max;
+
+  void add(int val)
+    {
+    int b = 0;
+    while (val >> b)
+      ++b;
+    while (bins.len() <= b)
+      bins.add(0);
+    bins[b] = bins[b] + 1;
+    ++count;
+    sum += val;
+    if (val > max)
+      max = val;
+    }
+
+  void add(Histogram& h)
+    {
+    int x;
+    while (bins.len() < h.bins.len())
+      bins.add(0);
+    for (x = 0; x != h.bins.len(); ++x)
+      bins[x] = bins[x] + h.bins[x];
+    count += h.count;
+    sum += h.sum;
+    if (h.max > max)
+      max = h.max;
+    }
+
+  Histogram()
+    {
+    count = 0;
+    sum = 0;
+    max = 0;
+    }
+  };
+
+// Write histogram: a summary line, then one line per bucket
+
+static void stats_histogram(Out& out, const char *title, Histogram& h, const char *indent)
+  {
+  char buf[80];
+  int x;
+  sprintf(buf, "%.1f", h.count ? (double)h.sum / h.count : 0.0);
+  out << indent << title << ": " << h.count << ", mean " << buf << ", max " << h.max << '\n';
+  for (x = 0; x != h.bins.len(); ++x)
+    if (h.bins[x])
+      {
+      if (x < 2)
+        sprintf(buf, "%d", x);
+      else if (x == 2)
+        sprintf(buf, "2-3");
+      else
+        sprintf(buf, "%d-%d", 1 << (x - 1), (1 << x) - 1);
+      out << indent << "  " << buf << ": " << h.bins[x] << '\n';
+      }
+  }
+
+// An outlier net
+
+struct StatsNet
+  {
+  Net *net;
+  int pins;
+  int supply; // Set if it connects to a supply pin
+  };
+
+// Statistics for one view
+
+struct StatsView
+  {
+  View *v;
+  Histogram fanout; // Pins per net
+  Histogram pins; // Connected pins per instance
+  Array<StatsNet> big; // Outlier nets
+  };
+
+static StatsView *stats_view(View *v)
+  {
+  StatsView *s = new StatsView();
+  Hash<int> inst_pins; // Connected pins of each instance
+  Hash<Net *>::ptr np;
+  Hash<Instance *>::ptr ip;
+  s->v = v;
+  for (np = v->nets.first(); np; np++)
+    {
+    int n = 0;
+    for (Portref *r = np->pins; r; r = r->next)
+      {
+      ++n;
+      if (r->instance)
+        inst_pins[r->instance->name.name] = inst_pins.get(r->instance->name.name) + 1;
+      }
+    s->fanout.add(n);
+    }
+  for (ip = v->instances.first(); ip; ip++)
+    s->pins.add(inst_pins.get(ip->name.name));
+
+  // Outliers, now that we know the average
+  for (np = v->nets.first(); np; np++)
+    {
+    StatsNet b;
+    b.net = *np;
+    b.pins = 0;
+    b.supply = 0;
+    for (Portref *r = np->pins; r; r = r->next)
+      {
+      ++b.pins;
+      if (r->port && r->port->supply)
+        b.supply = 1;
+      }
+    if (b.pins >= STATS_BIG && (long long)b.pins * s->fanout.count > STATS_RATIO * s->fanout.sum)
+      s->big.add(b);
+    }
+  return s;
+  }
+
+// Sizes of the hierarchy under a design cell
+
+struct StatsCell
+  {
+  int depth; // Levels of design cells, including this one
+  long long flat; // Instances when flattened
+  int model; // Set if it has a simulation model: a leaf when flattened
+  };
+
+void stats_dump(Design *d, Out& out)
+  {
+  Array<Cell *> order;
+  Array<StatsView *> views;
+  Hash<StatsCell *> cells; // By lib\0cell
+  Histogram fanout, pins, per_view, uses, depth;
+  Hash<View *>::ptr vptr;
+  Hash<Instance *>::ptr ip;
+  Cell *top = find_top(d);
+  char buf[80];
+  int x, y;
+
+  if (!top)
+    {
+    cerr << "couldn't find top cell\n";
+    exit(-1);
+    }
+
+  // Each design view once, leaves first
+  cell_order(d, order);
+  for (x = 0; x != order.len(); ++x)
+    {
+    Cell *c = order[x];
+    StatsCell *sc = new StatsCell();
+    sc->depth = 1;
+    sc->flat = 0;
+    sc->model = 0;
+    for (vptr = c->views.first(); vptr; vptr++)
+      {
+      StatsView *s = stats_view(*vptr);
+      views.add(s);
+      fanout.add(s->fanout);
+      pins.add(s->pins);
+      per_view.add(vptr->instances.len());
+      if (vptr->sim.first())
+        sc->model = 1;
+      for (ip = vptr->instances.first(); ip; ip++)
+        {
+        Cell *ic = ip->ref.cell;
+        StatsCell *sub = ic ? cells.get(ic->mom->name.name + '\0' + ic->name.name) : 0;
+        if (sub && !sub->model)
+          {
+          if (sub->depth + 1 > sc->depth)
+            sc->depth = sub->depth + 1;
+          sc->flat += sub->flat;
+          }
+        else
+          ++sc->flat;
+        }
+      }
+    cells.add(c->mom->name.name + '\0' + c->name.name, sc);
+    depth.add(sc->depth);
+    Array<Instance *> *u = where_used(d, c);
+    if (c != top)
+      uses.add(u ? u->len() : 0);
+    }
+
+  StatsCell *t = cells.get(top->mom->name.name + '\0' + top->name.name);
+  sprintf(buf, "%lld", t->flat);
+  out << "Design " << d->name.name << '\n';
+  out << "  Top cell " << top->name.name << ": " << t->depth << " levels, " << buf << " instances flattened\n";
+  stats_histogram(out, "Nets by fan-out", fanout, "  ");
+  stats_histogram(out, "Instances by connected pins", pins, "  ");
+  stats_histogram(out, "Views by instances", per_view, "  ");
+  stats_histogram(out, "Cells by uses", uses, "  ");
+  stats_histogram(out, "Cells by hierarchy depth", depth, "  ");
+
+  for (x = 0, y = 0; x != views.len(); ++x)
+    y += views[x]->big.len();
+  if (y)
+    out << "  Outlier nets:\n";
+  for (x = 0; x != views.len(); ++x)
+    for (y = 0; y != views[x]->big.len(); ++y)
+      {
+      StatsNet& b = views[x]->big[y];
+      out << "    " << views[x]->v->mom->name.name << ' ' << b.net->name.name << ": " << b.pins << " pins";
+      if (b.supply)
+        out << " (supply)";
+      out << '\n';
+      }
+
+  for (x = 0; x != views.len(); ++x)
+    {
+    StatsView *s = views[x];
+    out << "View " << s->v->mom->name.name << ' ' << s->v->name.name << '\n';
+    out << "  Instances " << s->v->instances.len() << ", nets " << s->v->nets.len() << ", ports " << s->v->ports.len() << '\n';
+    stats_histogram(out, "Nets by fan-out", s->fanout, "  ");
+    stats_histogram(out, "Instances by connected pins", s->pins, "  ");
+    delete s;
+    }
+
+  Hash<StatsCell *>::ptr cp;
+  for (cp = cells.first(); cp; cp++)
+    delete *cp;
+  }
@@ -0,0 +1,6 @@
+// Connectivity statistics
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Write histograms of fan-out, pins per instance, hierarchy and outlier nets
+void stats_dump(Design *d, Out& out);
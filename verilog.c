@@ -5,85 +5,209 @@
 #include <fstream>
 #include <string>
 #include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 using namespace std;
 
+extern int debug;
+
 #include "hash.h"
 #include "dlist.h"
+#include "clist.h"
+#include "array.h"
 #include "lisp.h"
 #include "net.h"
 #include "verilog.h"
+#include "outfile.h"
+#include "gatemap.h"
+#include "flat.h"
+#include "part.h"
+
+int verilog_share;
+
+// Character tables for names: what each character turns into and whether
+// the result may appear in a simple verilog identifier.
+
+static unsigned char lower_map[256]; // For lowerize_string (file names)
+static unsigned char legal_map[256]; // For legalize_string
+static unsigned char legal_char[256]; // Set if legal_map[c] needs no quoting
+static int maps_ready;
+
+static void init_maps()
+  {
+  int c;
+  for (c = 0; c != 256; ++c)
+    {
+    lower_map[c] = legal_map[c] = c;
+    if (c >= 'A' && c <= 'Z')
+      lower_map[c] = legal_map[c] = c + 'a' - 'A';
+    if (c == ' ' || c == '/' || c == '.' || c == '\\')
+      lower_map[c] = '_';
+    if (c == ' ')
+      legal_map[c] = '_';
+    legal_char[c] = ((legal_map[c] >= 'a' && legal_map[c] <= 'z') ||
+                     (legal_map[c] >= '0' && legal_map[c] <= '9') ||
+                     legal_map[c] == '_');
+    }
+  maps_ready = 1;
+  }
 
 string lowerize_string(string s)
   {
   int x;
-  for (x = 0; x != s.length(); ++x)
-    if (s[x] >= 'A' && s[x] <= 'Z')
-      s[x] += 'a' - 'A';
-    else if (s[x] == ' ' || s[x] == '/' || s[x] == '.' || s[x] == '\\')
-      s[x] = '_';
+  if (!maps_ready)
+    init_maps();
+  for (x = 0; x != (int)s.length(); ++x)
+    s[x] = lower_map[(unsigned char)s[x]];
   return s;
   }
 
 string legalize_string(string s)
   {
   int x;
-  for (x = 0; x != s.length(); ++x)
+  int legal = 1;
+  if (!maps_ready)
+    init_maps();
+  for (x = 0; x != (int)s.length(); ++x)
     {
-    if (s[x] == ' ')
-      s[x] = '_';
-    else if (s[x] >= 'A' && s[x] <= 'Z')
-      s[x] += 'a' - 'A';
+    legal &= legal_char[(unsigned char)s[x]];
+    s[x] = legal_map[(unsigned char)s[x]];
     }
-  for (x = 0; x != s.length(); ++x)
-    if (!(s[x] >= 'A' && s[x] <= 'Z' ||
-          s[x] >= 'a' && s[x] <= 'z' ||
-          s[x] >= '0' && s[x] <= '9' ||
-          s[x] == '_'))
-      break;
-  if (x != s.length())
+  if (!legal)
     {
     return "\\" + s + " ";
     }
   return s;
   }
 
-void do_module(ostream& out, Cell *c, View *v)
+// Legal names, computed the first time they're needed and then kept
+// with the object: a part used 500 times has its names legalized once.
+
+string& emit_name(Port *p)
   {
-  Hash<Port *>::ptr pp;
-  Hash<Instance *>::ptr ip;
-  Hash<Net *>::ptr np;
+  if (p->emit_name.empty())
+    p->emit_name = legalize_string(p->name.name);
+  return p->emit_name;
+  }
 
+string& emit_name(Instance *i)
+  {
+  if (i->emit_name.empty())
+    i->emit_name = legalize_string(i->name.name);
+  return i->emit_name;
+  }
 
-  // Determine port names
-  for (pp = v->ports.first(); pp; pp++)
+string& emit_name(Cell *c)
+  {
+  if (verilog_share && c->same)
+    return emit_name(c->same);
+  if (c->emit_name.empty())
+    c->emit_name = legalize_string(c->name.name);
+  return c->emit_name;
+  }
+
+// Where instance pins are connected
+
+struct Wires
+  {
+  // Return wire connected to port p of instance l or "" if none
+  virtual string wire(Instance *l, Port *p) = 0;
+  };
+
+// Pins of an instance in view v
+
+struct ViewWires : Wires
+  {
+  View *v;
+  string wire(Instance *l, Port *p)
     {
-    pp->emit_name = legalize_string(pp->name.name);
+    return find_my_wire(v, l, p);
     }
+  };
 
-  // Determine net names
-  for (np = v->nets.first(); np; np++)
+// Emit one instance named legal_name (already legalized).  name is the
+// plain name.
+
+void emit_instance(Out& out, Instance *l, string name, string& legal_name, Wires& w)
+  {
+  View *vi;
+  GateMap *g;
+  if (l->ref.cell && l->ref.view && (g = gatemap_find(l->ref.cell)) && gatemap_ports(g, l->ref.view))
     {
-    pp = v->ports.find(np->name.name);
-    if (pp && !find_port_in_net(*np, NULL, *pp))
-      // Rename net if there is a port with same name which is not part of it
-      np->emit_name = legalize_string("n_" + np->name.name);
-    else
-      np->emit_name = legalize_string(np->name.name);
+    // Part is mapped to a gate primitive
+    int x;
+    string terms;
+    for (x = 0; x != g->ports.len(); ++x)
+      {
+      string wire = w.wire(l, g->ports[x]);
+      if (wire == "")
+        {
+        if (x < g->noutputs)
+          { // Primitive outputs can't be left open
+          wire = legalize_string(name + "_" + g->ports[x]->name.name + "_nc");
+          out << "wire " << wire << ";\n";
+          }
+        else
+          wire = "1'bz";
+        }
+      if (x)
+        terms += ", ";
+      terms += wire;
+      }
+    out << g->prim << " " << legal_name << " (" << terms << ");\n\n";
+    return;
+    }
+  // out << "    Instance " << l->name.name << " of " << l->ref.libraryRef << "." << l->ref.cellRef << '\n';
+  if (l->ref.cell)
+    out << emit_name(l->ref.cell);
+  else
+    out << legalize_string(l->ref.cellRef);
+  out << " " << legal_name << "\n";
+  out << "  (\n";
+  vi = l->ref.view;
+  if (vi)
+    {
+    Hash<Port *>::ptr portptr, nportptr;
+    for(portptr=vi->ports.first();portptr;portptr = nportptr)
+      {
+      nportptr = portptr.next();
+      Port *p=*portptr;
+      if (nportptr)
+        {
+        out << "  ." << emit_name(p) << " (" << w.wire(l, p) << "),\n";
+        }
+      else
+        {
+        out << "  ." << emit_name(p) << " (" << w.wire(l, p) << ")\n";
+        }
+      }
+    }
+  else
+    {
+    out << "  // Couldn't not find this part - broken reference.\n";
     }
+  out << "  );\n\n";
+  }
+
+// Emit module header: module statement and port declarations
+
+void emit_header(Out& out, Cell *c, View *v)
+  {
+  Hash<Port *>::ptr pp;
 
   // Emit module
   out << "// " << c->name.name << '\n';
-  out << "\nmodule " << legalize_string(c->name.name) << '\n';
+  out << "\nmodule " << emit_name(c) << '\n';
   out << "  (\n";
 
   for (pp = v->ports.first(); pp; pp++)
     {
     if (pp.next())
-      out << "  " << pp->emit_name << ",\n";
+      out << "  " << emit_name(*pp) << ",\n";
     else
-      out << "  " << pp->emit_name << "\n";
+      out << "  " << emit_name(*pp) << "\n";
     }
   out << "  );\n\n";
 
@@ -95,27 +219,79 @@ void do_module(ostream& out, Cell *c, View *v)
       {
       case 0:
         {
-        out << "input " << pp->emit_name << ";\n";
+        out << "input " << emit_name(*pp) << ";\n";
         break;
         }
       case 1:
         {
-        out << "output " << pp->emit_name << ";\n";
+        out << "output " << emit_name(*pp) << ";\n";
         break;
         }
       case 2:
         {
-        out << "inout " << pp->emit_name << ";\n";
+        out << "inout " << emit_name(*pp) << ";\n";
         break;
         }
       }
     }
   out << "\n";
+  }
+
+// Connect port to net with name wire
+
+void emit_port_net(Out& out, Port *p, string& wire)
+  {
+  if (wire == emit_name(p))
+    out << "// port name == net name == " << wire << "\n";
+  else
+    switch (p->direction)
+      {
+      case 0: // Input
+        {
+        out << "assign " << wire << " = " << emit_name(p) << ";\n";
+        break;
+        }
+      case 1: // Output
+        {
+        out << "assign " << emit_name(p) << " = " << wire << ";\n";
+        break;
+        }
+      case 2: // InOut
+        {
+        out << "// ERROR inout port and net with different names: " << emit_name(p) << " " << wire << "\n";
+        break;
+        }
+      }
+  }
+
+void do_module(Out& out, Cell *c, View *v)
+  {
+  Hash<Port *>::ptr pp;
+  Hash<Instance *>::ptr ip;
+  Hash<Net *>::ptr np;
+
+
+  // Determine net names
+  for (np = v->nets.first(); np; np++)
+    {
+    pp = v->ports.find(np->name.name);
+    if (pp && !find_port_in_net(*np, NULL, *pp))
+      // Rename net if there is a port with same name which is not part of it
+      np->emit_name = legalize_string("n_" + np->name.name);
+    else
+      np->emit_name = legalize_string(np->name.name);
+    }
+
+  emit_header(out, c, v);
 
   // Declare nets...
   out << "// Declare nets\n";
   for (np = v->nets.first(); np; np++)
     {
+    // Code may declare port as a reg: leave it to the port declaration
+    Portref *r = np->pins;
+    if (v->sim.len() && r && !r->next && !r->instance && r->port && np->emit_name == emit_name(r->port))
+      continue;
     out << "wire " << np->emit_name << ";\n";
     }
   out << "\n";
@@ -126,29 +302,7 @@ void do_module(ostream& out, Cell *c, View *v)
     {
     np = find_net_with_port(v, NULL, *pp);
     if (np)
-      {
-      if (np->emit_name == pp->emit_name)
-        out << "// port name == net name == " << np->emit_name << "\n";
-      else
-        switch (pp->direction)
-          {
-          case 0: // Input
-            {
-            out << "assign " << np->emit_name << " = " << pp->emit_name << ";\n";
-            break;
-            }
-          case 1: // Output
-            {
-            out << "assign " << pp->emit_name << " = " << np->emit_name << ";\n";
-            break;
-            }
-          case 2: // InOut
-            {
-            out << "// ERROR inout port and net with different names: " << pp->emit_name << " " << np->emit_name << "\n";
-            break;
-            }
-          }
-      }
+      emit_port_net(out, *pp, np->emit_name);
     }
   out << "\n";
 
@@ -156,87 +310,426 @@ void do_module(ostream& out, Cell *c, View *v)
   if (v->sim.len())
     {
     out << "// Code copied from schematic |sim lines\n";
-    for (Dlist<string>::ptr sp = v->sim.first(); sp; ++sp)
-      out << *sp << "\n";
+    for (Clist<string>::ptr sp = v->sim.first(); sp; ++sp)
+      {
+      // Gathered straight from the View: no copy
+      out.ref(sp.item());
+      out << "\n";
+      }
     out << "\n";
     }
 
   // Emit instances
   out << "// Instances\n";
+  ViewWires w;
+  w.v = v;
   for(ip=v->instances.first();ip;ip++)
+    emit_instance(out, *ip, ip->name.name, emit_name(*ip), w);
+  out << "\nendmodule\n";
+  }
+
+// Modules are emitted leaves first.  With a path, each module goes in
+// its own file and a file list for the simulator (design.f) goes with
+// them in the same order.  Names in the list are relative to its
+// directory, so the directory can be moved.  Each line of the list has
+// the hash of the file's contents so that build tools can tell what
+// changed without reading the files.  With verilog_share, cells which fingerprint() found
+// to be identical to an earlier one are left out, and their instances
+// use the earlier one's module.
+
+void verilog_dump(Design *d, char *path, Out& out)
+  {
+  Array<Cell *> order;
+  Out flist(-1);
+  char buf[40];
+  int x;
+  cell_order(d, order);
+  if (!path) out << "// Design " << d->name.name << '\n';
+  else flist << "// Design " << d->name.name << ": compile in this order\n";
+  for (x = 0; x != order.len(); ++x)
     {
-    Instance *l=*ip;
-    View *vi;
-    // out << "    Instance " << l->name.name << " of " << l->ref.libraryRef << "." << l->ref.cellRef << '\n';
-    out << legalize_string(l->ref.cellRef) << " " << legalize_string(l->name.name) << "\n";
-    out << "  (\n";
-    vi = l->ref.view;
-    if (vi)
+    Cell *c = order[x];
+    Hash<View *>::ptr vptr;
+    if (verilog_share && c->same)
+      continue;
+    for (vptr=c->views.first();vptr;vptr++)
       {
-      Hash<Port *>::ptr portptr, nportptr;
-      for(portptr=vi->ports.first();portptr;portptr = nportptr)
-        {
-        nportptr = portptr.next();
-        Port *p=*portptr;
-        if (nportptr)
-          {
-          out << "  ." << legalize_string(p->name.name) << " (" << find_my_wire(v, l, p) << "),\n";
-          }
-        else
-          {
-          out << "  ." << legalize_string(p->name.name) << " (" << find_my_wire(v, l, p) << ")\n";
-          }
+      View *v = *vptr;
+      if (path)
+        {
+        // Render module first: only replace file if it changed so that
+        // whatever depends on it doesn't get rebuilt.
+        string file = lowerize_string(c->name.name) + ".v";
+        string name = string(path) + "/" + file;
+        Out fout(-1);
+        do_module(fout, c, v);
+        sprintf(buf, " // %016llx\n", fout.hash());
+        flist << file << buf;
+        int rtn = update_file(name, fout);
+        if (rtn < 0)
+          exit(-1);
+        else if (!rtn && debug)
+          cout << name << " unchanged\n";
+        }
+      else
+        {
+        do_module(out, c, v);
         }
       }
+    }
+  if (path)
+    {
+    string name = string(path) + "/" + lowerize_string(d->name.name) + ".f";
+    int rtn = update_file(name, flist);
+    if (rtn < 0)
+      exit(-1);
+    else if (!rtn && debug)
+      cout << name << " unchanged\n";
+    }
+  }
+
+// Pins of a leaf instance in the flattened design
+
+struct FlatWires : Wires
+  {
+  FlatInst *fi;
+  Array<string> *names; // Wire name of each flat net
+  string wire(Instance *l, Port *p)
+    {
+    int x;
+    for (x = 0; x != fi->pins.len(); ++x)
+      if (fi->pins[x].port == p)
+        return (*names)[fi->pins[x].net->id];
+    return "";
+    }
+  };
+
+// Determine flat net names: nets with top-level ports are named after
+// the port.
+
+static void flat_names(Flat *f, Array<string>& names)
+  {
+  View *v = f->view;
+  int x, y;
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    for (y = 0; y != n->pins.len(); ++y)
+      if (!n->pins[y].inst)
+        break;
+    if (y != n->pins.len())
+      names.add(emit_name(n->pins[y].port));
+    else if (v->ports.find(n->path))
+      // Rename net if there is a port with same name which is not part of it
+      names.add(legalize_string("n_" + n->path));
     else
-      {
-      out << "  // Couldn't not find this part - broken reference.\n";
-      }
-    out << "  );\n\n";
+      names.add(legalize_string(n->path));
     }
-  out << "\nendmodule\n";
   }
 
-void verilog_dump(Design *d, char *path, ostream& out)
+// Emit whole design as one module with every leaf instance named by its
+// hierarchical path.  Sheets with |sim models stay instances: their
+// modules follow the flat one.
+
+void verilog_flat_dump(Design *d, char *path, Out& out)
   {
-  if (!path) out << "// Design " << d->name.name << '\n';
-  Hash<Lib *>::ptr lptr;
-  for (lptr=d->libraries.first(); lptr; lptr++)
+  Flat *f = flatten(d);
+  int x, y;
+  if (!f)
+    {
+    cerr << "couldn't find top cell to flatten\n";
+    exit(-1);
+    }
+  Out fout(-1);
+  Out& o = path ? fout : out;
+  View *v = f->view;
+  Array<string> names;
+
+  flat_names(f, names);
+
+  o << "// Design " << d->name.name << " (flattened)\n";
+  emit_header(o, f->top, v);
+
+  // Declare nets...
+  o << "// Declare nets\n";
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    for (y = 0; y != n->pins.len(); ++y)
+      if (!n->pins[y].inst)
+        break;
+    if (y == n->pins.len())
+      o << "wire " << names[x] << ";\n";
+    }
+  o << "\n";
+
+  // Other ports on a net named after a port
+  o << "// Connect ports to nets\n";
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    for (y = 0; y != n->pins.len(); ++y)
+      if (!n->pins[y].inst)
+        emit_port_net(o, n->pins[y].port, names[x]);
+    }
+  o << "\n";
+
+  // Emit leaf instances
+  Hash<Cell *> models; // Sheets with |sim models we use
+  FlatWires w;
+  w.names = &names;
+  o << "// Instances\n";
+  for (x = 0; x != f->insts.len(); ++x)
+    {
+    FlatInst *fi = f->insts[x];
+    string legal_name = legalize_string(fi->path);
+    w.fi = fi;
+    emit_instance(o, fi->inst, fi->path, legal_name, w);
+    Cell *c = fi->inst->ref.cell;
+    if (c && !c->mom->lib_type && !models.get(c->name.name))
+      models.add(c->name.name, c);
+    }
+  o << "\nendmodule\n";
+
+  // Emit model sheets
+  Hash<Cell *>::ptr cp;
+  for (cp = models.first(); cp; cp++)
+    {
+    o << "\n";
+    do_module(o, *cp, *cp->views.first());
+    }
+
+  if (path && update_file(path, fout) < 0)
+    exit(-1);
+  }
+
+// Pin may drive its net (passive pins count: current goes both ways)
+
+static int pin_drives(Port *p)
+  {
+  if (p->type)
+    return strchr("OTCEBP", p->type) != 0;
+  return p->direction == 1 || p->direction == 2;
+  }
+
+// Pin only drives its net
+
+static int pin_output(Port *p)
+  {
+  if (p->type)
+    return strchr("OTCE", p->type) != 0;
+  return p->direction == 1;
+  }
+
+int verilog_parts = 2;
+
+// Emit flattened design split into verilog_parts parts (see part.c): a
+// module for each part, whose ports are the nets it shares with other
+// parts or with ports of the design, then a top module which connects the
+// parts together.  A port is an output if only its part drives the net,
+// an input if its part doesn't drive it, otherwise inout.
+
+void verilog_part_dump(Design *d, char *path, Out& out)
+  {
+  Flat *f = flatten(d);
+  int x, y, p;
+  if (!f)
     {
-    Lib *l = *lptr;
-    Hash<Cell *>::ptr cptr;
-    // out << "  Library " << l->name.name << '\n';
-    if (!l->lib_type) for (cptr=l->cells.first();cptr;cptr++)
+    cerr << "couldn't find top cell to flatten\n";
+    exit(-1);
+    }
+  Out fout(-1);
+  Out& o = path ? fout : out;
+  View *v = f->view;
+  Array<string> names;
+  Array<int> part; // Part of each instance
+  Array<int> net_part; // Part of each net: -1 if none, -2 if more than one
+  Array<int> net_drivers; // No. parts which drive each net (2 for 2 or more)
+  Array<int> net_driver; // Last part which drove net
+  Array<int> stamp; // Last part which declared net
+  Array<Array<FlatInst *> *> members; // Instances in each part
+  int cut = partition(f, verilog_parts, part);
+
+  flat_names(f, names);
+
+  // Which nets go between parts
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    int np = -1, nd = 0, last = -1;
+    for (y = 0; y != n->pins.len(); ++y)
       {
-      Cell *c = *cptr;
-      // out << "    Cell " << c->name.name << '\n';
-      Hash<View *>::ptr vptr;
-      for (vptr=c->views.first();vptr;vptr++)
-        {
-        View *v = *vptr;
-        fstream fout;
-        if (path)
-          {
-          string p = path;
-          string name = p + "/" + lowerize_string(c->name.name) + ".v";
-          fout.open(name.c_str(),ios::out);
-          if (!fout)
-            {
-            cerr << "couldn't open " << name << "\n";
-            exit(-1);
-            }
-          do_module(fout, c, v);
-          fout.close();
-          if (!fout)
-            {
-            cerr << "close error " << name << "\n";
-            }
-          }
+      FlatPin *fp = &n->pins[y];
+      if (!fp->inst)
+        {
+        // Port of the design: needs to get to the top module
+        np = -2;
+        if (fp->port->direction != 1)
+          nd = 2;
+        continue;
+        }
+      p = part[fp->inst->id];
+      if (np == -1)
+        np = p;
+      else if (np != p)
+        np = -2;
+      if (pin_drives(fp->port) && p != last)
+        {
+        if (last == -1)
+          nd = nd ? 2 : 1;
         else
-          {
-          do_module(out, c, v);
-          }
+          nd = 2;
+        last = p;
         }
       }
+    net_part.add(np);
+    net_drivers.add(nd);
+    net_driver.add(last);
+    stamp.add(-1);
     }
+
+  for (p = 0; p != verilog_parts; ++p)
+    members.add(new Array<FlatInst *>());
+  for (x = 0; x != f->insts.len(); ++x)
+    members[part[x]]->add(f->insts[x]);
+
+  o << "// Design " << d->name.name << " (flattened, " << verilog_parts << " parts, " << cut << " nets between parts)\n";
+
+  // Part modules
+  FlatWires w;
+  w.names = &names;
+  for (p = 0; p != verilog_parts; ++p)
+    {
+    Array<FlatInst *>& m = *members[p];
+    Array<int> ports; // Boundary nets of this part
+    Array<int> wires; // Other nets
+    if (!m.len())
+      continue;
+    for (x = 0; x != m.len(); ++x)
+      for (y = 0; y != m[x]->pins.len(); ++y)
+        {
+        int id = m[x]->pins[y].net->id;
+        if (stamp[id] == p)
+          continue;
+        stamp[id] = p;
+        if (net_part[id] == -2)
+          ports.add(id);
+        else
+          wires.add(id);
+        }
+    o << "\n// Part " << p << ": " << m.len() << " instances, " << ports.len() << " ports\n";
+    o << "\nmodule " << emit_name(f->top) << "_part" << p << '\n';
+    o << "  (\n";
+    for (x = 0; x != ports.len(); ++x)
+      o << "  " << names[ports[x]] << (x + 1 != ports.len() ? ",\n" : "\n");
+    o << "  );\n\n";
+    o << "// Declare ports\n";
+    for (x = 0; x != ports.len(); ++x)
+      {
+      int id = ports[x];
+      int drives = (net_driver[id] == p);
+      if (!drives)
+        {
+        // net_driver is just the last part: look for ours
+        FlatNet *n = f->nets[id];
+        for (y = 0; y != n->pins.len() && !drives; ++y)
+          if (n->pins[y].inst && part[n->pins[y].inst->id] == p && pin_drives(n->pins[y].port))
+            drives = 1;
+        }
+      if (!drives)
+        o << "input ";
+      else if (net_drivers[id] == 1)
+        {
+        // Bidirectional pins of ours make it inout
+        FlatNet *n = f->nets[id];
+        for (y = 0; y != n->pins.len(); ++y)
+          if (n->pins[y].inst && part[n->pins[y].inst->id] == p && pin_drives(n->pins[y].port) && !pin_output(n->pins[y].port))
+            break;
+        o << (y == n->pins.len() ? "output " : "inout ");
+        }
+      else
+        o << "inout ";
+      o << names[id] << ";\n";
+      }
+    o << "\n// Declare nets\n";
+    for (x = 0; x != wires.len(); ++x)
+      o << "wire " << names[wires[x]] << ";\n";
+    o << "\n// Instances\n";
+    for (x = 0; x != m.len(); ++x)
+      {
+      string legal_name = legalize_string(m[x]->path);
+      w.fi = m[x];
+      emit_instance(o, m[x]->inst, m[x]->path, legal_name, w);
+      }
+    o << "\nendmodule\n";
+    }
+
+  // Top module
+  o << "\n";
+  emit_header(o, f->top, v);
+  o << "// Declare nets\n";
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    if (net_part[x] != -2)
+      continue;
+    for (y = 0; y != n->pins.len(); ++y)
+      if (!n->pins[y].inst)
+        break;
+    if (y == n->pins.len())
+      o << "wire " << names[x] << ";\n";
+    }
+  o << "\n";
+  o << "// Connect ports to nets\n";
+  for (x = 0; x != f->nets.len(); ++x)
+    {
+    FlatNet *n = f->nets[x];
+    for (y = 0; y != n->pins.len(); ++y)
+      if (!n->pins[y].inst)
+        emit_port_net(o, n->pins[y].port, names[x]);
+    }
+  o << "\n";
+  o << "// Parts\n";
+  for (x = 0; x != stamp.len(); ++x)
+    stamp[x] = -1;
+  for (p = 0; p != verilog_parts; ++p)
+    {
+    Array<FlatInst *>& m = *members[p];
+    Array<int> ports;
+    if (!m.len())
+      continue;
+    for (x = 0; x != m.len(); ++x)
+      for (y = 0; y != m[x]->pins.len(); ++y)
+        {
+        int id = m[x]->pins[y].net->id;
+        if (stamp[id] != p && net_part[id] == -2)
+          ports.add(id);
+        stamp[id] = p;
+        }
+    o << emit_name(f->top) << "_part" << p << " part" << p << "\n";
+    o << "  (\n";
+    for (x = 0; x != ports.len(); ++x)
+      o << "  ." << names[ports[x]] << " (" << names[ports[x]] << (x + 1 != ports.len() ? "),\n" : ")\n");
+    o << "  );\n\n";
+    }
+  o << "\nendmodule\n";
+
+  // Model sheets
+  Hash<Cell *> models;
+  for (x = 0; x != f->insts.len(); ++x)
+    {
+    Cell *c = f->insts[x]->inst->ref.cell;
+    if (c && !c->mom->lib_type && !models.get(c->name.name))
+      {
+      models.add(c->name.name, c);
+      o << "\n";
+      do_module(o, c, *c->views.first());
+      }
+    }
+
+  for (p = 0; p != verilog_parts; ++p)
+    delete members[p];
+
+  if (path && update_file(path, fout) < 0)
+    exit(-1);
   }
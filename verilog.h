@@ -1,4 +1,20 @@
 // Copyright (C) 2008 Joseph H. Allen
 // See file COPYING for license.
 
-void verilog_dump(Design *d, char *name, ostream& out);
+// Set to write one module for cells which are identical (see fingerprint.c)
+extern int verilog_share;
+
+void verilog_dump(Design *d, char *name, Out& out);
+
+// Emit one module
+void do_module(Out& out, Cell *c, View *v);
+
+// Emit design as one flat module: path is the output file name
+void verilog_flat_dump(Design *d, char *path, Out& out);
+
+// No. parts for verilog_part_dump
+extern int verilog_parts;
+
+// Emit flattened design as a module for each part plus a top module
+// which connects them: path is the output file name
+void verilog_part_dump(Design *d, char *path, Out& out);
@@ -0,0 +1,1357 @@
+// Verilog netlist reader
+
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Reads structural verilog: modules with port, wire and instance
+// statements, like the ones we write.  Vectors are split into bits named
+// like A[3].  An assign which only connects wires together just merges
+// them into one net.
+//
+// A module with anything else in it (always blocks, regs, expressions)
+// is kept as a model, the same as a sheet with |sim lines: ports are
+// kept, and everything except the port declarations is copied as text.
+//
+// Cells which are instantiated but not defined go in library "verilog".
+// They get ports as connections are found for them.  Gate primitives
+// become cells like and3 (and with three terminals) in the gate map.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+extern int debug;
+
+#include "hash.h"
+#include "dlist.h"
+#include "clist.h"
+#include "array.h"
+#include "net.h"
+#include "gatemap.h"
+#include "vread.h"
+
+// Tokens
+
+enum
+  {
+  VT_EOF,
+  VT_ID, // Identifier: escaped ones are without the backslash
+  VT_NUM, // Number, like 12 or 4'b10z1
+  VT_STR, // String
+  VT_CHAR // Anything else: one character
+  };
+
+struct VLex
+  {
+  const char *name; // File name for messages
+  const char *p; // Next character
+  const char *end; // End of input
+  int line;
+
+  // Current token
+  int type;
+  const char *s; // Start of it
+  int len;
+  const char *before; // End of previous token
+  int tline;
+
+  void next();
+  int is(const char *kw); // Check if token is keyword or character
+  string str() { return string(s, len); }
+  void error(const char *msg);
+  };
+
+void VLex::error(const char *msg)
+  {
+  cerr << name << " " << tline << ": Error: " << msg << "\n";
+  throw LoadError();
+  }
+
+int VLex::is(const char *kw)
+  {
+  return type != VT_EOF && type != VT_STR && !strncmp(s, kw, len) && !kw[len];
+  }
+
+static int id_char(int c)
+  {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+  }
+
+static int num_char(int c)
+  {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ||
+         c == 'x' || c == 'X' || c == 'z' || c == 'Z' || c == '?' || c == '_';
+  }
+
+void VLex::next()
+  {
+  before = s + len;
+  for (;;)
+    {
+    // Skip whitespace and comments
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+      if (*p++ == '\n')
+        ++line;
+    if (p + 1 < end && p[0] == '/' && p[1] == '/')
+      {
+      while (p != end && *p != '\n')
+        ++p;
+      }
+    else if (p + 1 < end && p[0] == '/' && p[1] == '*')
+      {
+      p += 2;
+      while (p != end && !(*p == '*' && p + 1 < end && p[1] == '/'))
+        if (*p++ == '\n')
+          ++line;
+      if (p != end)
+        p += 2;
+      }
+    else if (p != end && *p == '`')
+      {
+      // Compiler directive: skip the line
+      while (p != end && *p != '\n')
+        ++p;
+      }
+    else
+      break;
+    }
+  tline = line;
+  s = p;
+  if (p == end)
+    {
+    type = VT_EOF;
+    len = 0;
+    return;
+    }
+  if (*p == '\\')
+    {
+    // Escaped identifier: up to whitespace
+    s = ++p;
+    while (p != end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+      ++p;
+    type = VT_ID;
+    len = p - s;
+    return;
+    }
+  if ((*p >= '0' && *p <= '9') || *p == '\'')
+    {
+    // Number: size, then base and digits
+    while (p != end && ((*p >= '0' && *p <= '9') || *p == '_' || *p == '.'))
+      ++p;
+    if (p != end && id_char(*p) && *s != '\'')
+      {
+      // Not legal, but we write names like this for parts like 74LS04
+      while (p != end && id_char(*p))
+        ++p;
+      type = VT_ID;
+      len = p - s;
+      return;
+      }
+    if (p != end && *p == '\'')
+      {
+      ++p;
+      if (p != end && (*p == 's' || *p == 'S'))
+        ++p;
+      if (p != end)
+        ++p; // Base
+      while (p != end && num_char(*p))
+        ++p;
+      }
+    type = VT_NUM;
+    len = p - s;
+    return;
+    }
+  if (id_char(*p))
+    {
+    while (p != end && id_char(*p))
+      ++p;
+    type = VT_ID;
+    len = p - s;
+    return;
+    }
+  if (*p == '"')
+    {
+    ++p;
+    while (p != end && *p != '"')
+      {
+      if (*p == '\\' && p + 1 != end)
+        ++p;
+      if (*p++ == '\n')
+        ++line;
+      }
+    if (p != end)
+      ++p;
+    type = VT_STR;
+    len = p - s;
+    return;
+    }
+  type = VT_CHAR;
+  len = 1;
+  ++p;
+  }
+
+// Parsed module
+
+struct VRange
+  {
+  int msb, lsb;
+  };
+
+struct VConn
+  {
+  string port; // Port name or "" for positional connection
+  Array<string> bits; // Wires connected, msb first.  "" for none.
+  };
+
+struct VSpan
+  {
+  const char *s;
+  int len;
+  };
+
+struct VInst
+  {
+  string cell;
+  string name;
+  int line;
+  Array<VConn *> conns;
+  };
+
+struct VModule
+  {
+  string name;
+  int line;
+  int model; // Set if there is behavioral code
+  Array<string> port_order; // Port names in header order
+  Hash<int> dirs; // Port directions + 1
+  Hash<VRange *> ranges; // Ranges of vectors
+  Array<string> wires; // Declared wire bits
+  Array<VInst *> insts;
+  Array<string> aliases; // Pairs of bits joined by assign statements
+  Array<VSpan> items; // Source of statements other than port declarations
+  Array<string> regs; // reg declarations for outputs
+  Array<string> text; // Code for models
+  Cell *cell;
+  View *view;
+  };
+
+// Parser state
+
+struct VRead
+  {
+  VLex lex;
+  VModule *m; // Module being parsed
+  Hash<VModule *> modules;
+  int nonames; // For naming unnamed primitive instances
+
+  void expect(const char *what);
+  VRange *range(); // Parse [msb:lsb] if there is one
+  void bits(string name, VRange *r, Array<string>& out);
+  int expr(Array<string>& out);
+  void skip_balanced();
+  void skip_statement();
+  void skip_until(const char *kw);
+  void skip_item();
+  void declaration(int dir);
+  void port_header();
+  void assign();
+  void instance();
+  void module();
+  };
+
+void VRead::expect(const char *what)
+  {
+  if (!lex.is(what))
+    {
+    string msg = string("expected ") + what;
+    lex.error(msg.c_str());
+    }
+  lex.next();
+  }
+
+static int number(VLex& lex)
+  {
+  if (lex.type != VT_NUM)
+    lex.error("can't handle range which isn't a plain number");
+  int n = atoi(lex.str().c_str());
+  lex.next();
+  return n;
+  }
+
+VRange *VRead::range()
+  {
+  if (!lex.is("["))
+    return 0;
+  lex.next();
+  VRange *r = new VRange();
+  r->msb = number(lex);
+  expect(":");
+  r->lsb = number(lex);
+  expect("]");
+  return r;
+  }
+
+// Names of bits of name, msb first
+
+void VRead::bits(string name, VRange *r, Array<string>& out)
+  {
+  char buf[16];
+  int x;
+  if (!r)
+    {
+    out.add(name);
+    return;
+    }
+  for (x = r->msb; ; x += (r->msb > r->lsb ? -1 : 1))
+    {
+    sprintf(buf, "[%d]", x);
+    out.add(name + buf);
+    if (x == r->lsb)
+      break;
+    }
+  }
+
+// Bits of a constant.  Bits which are 0 or 1 become wires named 1'b0 or
+// 1'b1, others are left unconnected.
+
+static void const_bits(string s, Array<string>& out)
+  {
+  int size = 32;
+  int base = 10;
+  int x, y;
+  int q = s.find('\'');
+  string digits = s;
+  Array<int> v; // Bit values lsb first: 0, 1 or -1
+  if (q != (int)string::npos)
+    {
+    if (q)
+      size = atoi(s.c_str());
+    ++q;
+    if (s[q] == 's' || s[q] == 'S')
+      ++q;
+    switch (s[q])
+      {
+      case 'b': case 'B': base = 2; break;
+      case 'o': case 'O': base = 8; break;
+      case 'h': case 'H': base = 16; break;
+      default: base = 10; break;
+      }
+    digits = s.substr(q + 1);
+    }
+  if (base == 10)
+    {
+    unsigned long long n = strtoull(digits.c_str(), 0, 10);
+    for (x = 0; x != 64; ++x)
+      v.add((n >> x) & 1);
+    }
+  else
+    {
+    int w = (base == 2 ? 1 : base == 8 ? 3 : 4);
+    for (x = digits.length(); x--; )
+      {
+      int c = digits[x];
+      int d;
+      if (c == '_')
+        continue;
+      if (c >= '0' && c <= '9')
+        d = c - '0';
+      else if (c >= 'a' && c <= 'f')
+        d = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        d = c - 'A' + 10;
+      else
+        d = -1; // x or z
+      for (y = 0; y != w; ++y)
+        v.add(d == -1 ? -1 : (d >> y) & 1);
+      }
+    }
+  for (x = size; x--; )
+    {
+    int b = x < v.len() ? v[x] : 0;
+    out.add(b == -1 ? "" : b ? "1'b1" : "1'b0");
+    }
+  }
+
+// Parse connection expression: wire, bit or part select, constant or
+// concatenation.  Returns false if it's anything else.
+
+int VRead::expr(Array<string>& out)
+  {
+  int x;
+  if (lex.type == VT_NUM)
+    {
+    const_bits(lex.str(), out);
+    lex.next();
+    return 1;
+    }
+  if (lex.type == VT_ID)
+    {
+    string name = lex.str();
+    lex.next();
+    if (lex.is("["))
+      {
+      VRange r;
+      lex.next();
+      if (lex.type != VT_NUM)
+        return 0;
+      r.msb = r.lsb = number(lex);
+      if (lex.is(":"))
+        {
+        lex.next();
+        if (lex.type != VT_NUM)
+          return 0;
+        r.lsb = number(lex);
+        }
+      if (!lex.is("]"))
+        return 0;
+      lex.next();
+      bits(name, &r, out);
+      }
+    else
+      bits(name, m->ranges.get(name), out);
+    return 1;
+    }
+  if (lex.is("{"))
+    {
+    lex.next();
+    if (lex.type == VT_NUM && !strchr(lex.str().c_str(), '\''))
+      {
+      // Replication: {n{...}}
+      int n = number(lex);
+      Array<string> r;
+      if (!lex.is("{"))
+        return 0;
+      lex.next();
+      do
+        if (!expr(r))
+          return 0;
+        while (lex.is(",") && (lex.next(), 1));
+      if (!lex.is("}"))
+        return 0;
+      lex.next();
+      while (n--)
+        for (x = 0; x != r.len(); ++x)
+          out.add(r[x]);
+      }
+    else
+      {
+      do
+        if (!expr(out))
+          return 0;
+        while (lex.is(",") && (lex.next(), 1));
+      }
+    if (!lex.is("}"))
+      return 0;
+    lex.next();
+    return 1;
+    }
+  return 0;
+  }
+
+// Skip (...), [...], {...} or begin...end starting at current token
+
+void VRead::skip_balanced()
+  {
+  int depth = 0;
+  do
+    {
+    if (lex.type == VT_EOF)
+      lex.error("unexpected end of file");
+    if (lex.is("(") || lex.is("[") || lex.is("{"))
+      ++depth;
+    else if (lex.is(")") || lex.is("]") || lex.is("}"))
+      --depth;
+    lex.next();
+    } while (depth);
+  }
+
+// Skip until keyword which ends a block, like endfunction, allowing for
+// nesting
+
+void VRead::skip_until(const char *kw)
+  {
+  string start = lex.str();
+  int depth = 0;
+  for (;;)
+    {
+    if (lex.type == VT_EOF)
+      lex.error("unexpected end of file");
+    if (lex.is(start.c_str()))
+      ++depth;
+    else if (lex.is(kw) && !--depth)
+      break;
+    lex.next();
+    }
+  lex.next();
+  }
+
+// Skip a behavioral statement
+
+void VRead::skip_statement()
+  {
+  if (lex.is("begin") || lex.is("fork"))
+    {
+    int depth = 0;
+    do
+      {
+      if (lex.type == VT_EOF)
+        lex.error("unexpected end of file");
+      if (lex.is("begin") || lex.is("fork"))
+        ++depth;
+      else if (lex.is("end") || lex.is("join") || lex.is("join_any") || lex.is("join_none"))
+        --depth;
+      lex.next();
+      } while (depth);
+    }
+  else if (lex.is("if"))
+    {
+    lex.next();
+    skip_balanced();
+    skip_statement();
+    if (lex.is("else"))
+      {
+      lex.next();
+      skip_statement();
+      }
+    }
+  else if (lex.is("case") || lex.is("casex") || lex.is("casez"))
+    {
+    int depth = 0;
+    do
+      {
+      if (lex.type == VT_EOF)
+        lex.error("unexpected end of file");
+      if (lex.is("case") || lex.is("casex") || lex.is("casez"))
+        ++depth;
+      else if (lex.is("endcase"))
+        --depth;
+      lex.next();
+      } while (depth);
+    }
+  else if (lex.is("@") || lex.is("#"))
+    {
+    lex.next();
+    if (lex.is("("))
+      skip_balanced();
+    else
+      lex.next();
+    skip_statement();
+    }
+  else if (lex.is("for") || lex.is("while") || lex.is("repeat") || lex.is("wait"))
+    {
+    lex.next();
+    skip_balanced();
+    skip_statement();
+    }
+  else if (lex.is("forever"))
+    {
+    lex.next();
+    skip_statement();
+    }
+  else
+    {
+    while (!lex.is(";"))
+      if (lex.is("(") || lex.is("[") || lex.is("{"))
+        skip_balanced();
+      else if (lex.type == VT_EOF)
+        lex.error("unexpected end of file");
+      else
+        lex.next();
+    lex.next();
+    }
+  }
+
+// Skip module item we don't understand: module becomes a model
+
+void VRead::skip_item()
+  {
+  if (lex.is("always") || lex.is("initial"))
+    {
+    lex.next();
+    skip_statement();
+    }
+  else if (lex.is("function"))
+    skip_until("endfunction");
+  else if (lex.is("task"))
+    skip_until("endtask");
+  else if (lex.is("generate"))
+    skip_until("endgenerate");
+  else if (lex.is("specify"))
+    skip_until("endspecify");
+  else
+    skip_statement();
+  m->model = 1;
+  }
+
+static int net_type(VLex& lex)
+  {
+  return lex.is("wire") || lex.is("tri") || lex.is("tri0") || lex.is("tri1") ||
+         lex.is("supply0") || lex.is("supply1") || lex.is("wand") || lex.is("wor") ||
+         lex.is("triand") || lex.is("trior") || lex.is("trireg") || lex.is("uwire");
+  }
+
+// Port or wire declaration: dir is -1 for wire, otherwise port direction.
+// Current token is just after input, output, inout or wire.  In module
+// headers the declaration ends at a comma followed by another direction.
+
+void VRead::declaration(int dir)
+  {
+  int reg = 0;
+  while (net_type(lex) || lex.is("reg") || lex.is("signed"))
+    {
+    if (lex.is("reg"))
+      reg = 1;
+    lex.next();
+    }
+  VRange *r = range();
+  if (lex.is("#"))
+    {
+    // Delay on a net
+    lex.next();
+    if (lex.is("("))
+      skip_balanced();
+    else
+      lex.next();
+    }
+  for (;;)
+    {
+    if (lex.type != VT_ID)
+      lex.error("expected name");
+    string name = lex.str();
+    lex.next();
+    if (r && !m->ranges.get(name))
+      m->ranges.add(name, r);
+    if (dir == -1)
+      bits(name, r, m->wires);
+    else
+      {
+      m->dirs[name] = dir + 1;
+      if (reg)
+        {
+        // Output is driven by behavioral code
+        char buf[40];
+        string decl = "reg ";
+        if (r)
+          {
+          sprintf(buf, "[%d:%d] ", r->msb, r->lsb);
+          decl += buf;
+          }
+        m->regs.add(decl + name + ";");
+        m->model = 1;
+        }
+      }
+    if (lex.is("="))
+      {
+      // Net declaration assignment: wire a = b;
+      Array<string> l, rr;
+      lex.next();
+      bits(name, r, l);
+      if (expr(rr) && l.len() == rr.len())
+        {
+        int x;
+        for (x = 0; x != l.len(); ++x)
+          if (rr[x] != "")
+            {
+            m->aliases.add(l[x]);
+            m->aliases.add(rr[x]);
+            }
+        }
+      else
+        {
+        while (!lex.is(",") && !lex.is(";"))
+          if (lex.is("(") || lex.is("[") || lex.is("{"))
+            skip_balanced();
+          else if (lex.type == VT_EOF)
+            lex.error("unexpected end of file");
+          else
+            lex.next();
+        m->model = 1;
+        }
+      }
+    if (!lex.is(","))
+      break;
+    lex.next();
+    if (lex.is("input") || lex.is("output") || lex.is("inout"))
+      break;
+    }
+  }
+
+// Port list in module header
+
+void VRead::port_header()
+  {
+  if (lex.is("#"))
+    {
+    cerr << lex.name << " " << lex.tline << ": Warning: parameters of module " << m->name << " ignored\n";
+    lex.next();
+    skip_balanced();
+    }
+  if (!lex.is("("))
+    return;
+  lex.next();
+  while (!lex.is(")"))
+    {
+    if (lex.is("input") || lex.is("output") || lex.is("inout"))
+      {
+      // ANSI style: input [3:0] a, b, output y
+      int dir = lex.is("input") ? 0 : lex.is("output") ? 1 : 2;
+      int first = m->dirs.len();
+      lex.next();
+      declaration(dir);
+      // declaration() adds names to dirs in order
+      Hash<int>::ptr p;
+      int x = 0;
+      for (p = m->dirs.first(); p; p++, x++)
+        if (x >= first)
+          m->port_order.add(p.key());
+      }
+    else if (lex.type == VT_ID)
+      {
+      m->port_order.add(lex.str());
+      lex.next();
+      if (lex.is(","))
+        lex.next();
+      }
+    else
+      lex.error("can't handle this port");
+    }
+  lex.next();
+  }
+
+// Assign statement: only ones which connect wires are understood
+
+void VRead::assign()
+  {
+  const char *start = lex.s;
+  int line = lex.tline;
+  lex.next();
+  for (;;)
+    {
+    Array<string> l, r;
+    int x;
+    if (!expr(l) || !lex.is("="))
+      break;
+    lex.next();
+    if (!expr(r) || l.len() != r.len() || (!lex.is(",") && !lex.is(";")))
+      break;
+    for (x = 0; x != l.len(); ++x)
+      if (r[x] != "")
+        {
+        m->aliases.add(l[x]);
+        m->aliases.add(r[x]);
+        }
+    if (lex.is(";"))
+      {
+      lex.next();
+      return;
+      }
+    lex.next();
+    }
+  // It's an expression: back up and keep it as code
+  lex.p = start;
+  lex.line = line;
+  lex.len = 0;
+  lex.s = start;
+  lex.next();
+  skip_item();
+  }
+
+// Gate primitives: output comes first
+
+static const char *gate_prims[] =
+  {
+  "and", "nand", "or", "nor", "xor", "xnor", "buf", "not",
+  "bufif0", "bufif1", "notif0", "notif1", 0
+  };
+
+static int is_prim(const string& s)
+  {
+  int x;
+  for (x = 0; gate_prims[x]; ++x)
+    if (s == gate_prims[x])
+      return 1;
+  return 0;
+  }
+
+// Instance statement: cell [#(...)] name (...), name (...);
+
+void VRead::instance()
+  {
+  string cell = lex.str();
+  lex.next();
+  if (lex.is("#"))
+    {
+    lex.next();
+    if (lex.is("("))
+      skip_balanced();
+    else
+      lex.next();
+    }
+  for (;;)
+    {
+    VInst *i = new VInst();
+    i->cell = cell;
+    i->line = lex.tline;
+    if (lex.type == VT_ID)
+      {
+      i->name = lex.str();
+      lex.next();
+      }
+    else if (lex.is("(") && is_prim(cell))
+      {
+      char buf[20];
+      sprintf(buf, "_g%d", ++nonames);
+      i->name = cell + buf;
+      }
+    else
+      lex.error("expected instance name");
+    if (lex.is("["))
+      lex.error("can't handle arrays of instances");
+    expect("(");
+    while (!lex.is(")"))
+      {
+      VConn *c = new VConn();
+      if (lex.is("."))
+        {
+        lex.next();
+        // Port names can be numbers (for pin numbers, see above)
+        if (lex.type != VT_ID && lex.type != VT_NUM)
+          lex.error("expected port name");
+        c->port = lex.str();
+        lex.next();
+        expect("(");
+        if (!lex.is(")") && !expr(c->bits))
+          lex.error("can't handle this expression in a connection");
+        expect(")");
+        }
+      else if (!lex.is(",") && !expr(c->bits))
+        lex.error("can't handle this expression in a connection");
+      i->conns.add(c);
+      if (lex.is(","))
+        {
+        lex.next();
+        if (lex.is(")"))
+          {
+          // Trailing empty positional connection
+          i->conns.add(new VConn());
+          }
+        }
+      else if (!lex.is(")"))
+        lex.error("expected , or )");
+      }
+    lex.next();
+    m->insts.add(i);
+    if (lex.is(";"))
+      break;
+    expect(",");
+    }
+  lex.next();
+  }
+
+void VRead::module()
+  {
+  m = new VModule();
+  m->model = 0;
+  m->cell = 0;
+  m->view = 0;
+  m->line = lex.tline;
+  lex.next();
+  if (lex.type != VT_ID)
+    lex.error("expected module name");
+  m->name = lex.str();
+  lex.next();
+  if (modules.get(m->name))
+    lex.error("module defined twice");
+  modules.add(m->name, m);
+  port_header();
+  expect(";");
+  while (!lex.is("endmodule"))
+    {
+    VSpan span;
+    int decl = 0;
+    span.s = lex.s;
+    if (lex.type == VT_EOF)
+      lex.error("missing endmodule");
+    if (lex.is("input") || lex.is("output") || lex.is("inout"))
+      {
+      int dir = lex.is("input") ? 0 : lex.is("output") ? 1 : 2;
+      lex.next();
+      declaration(dir);
+      expect(";");
+      decl = 1;
+      }
+    else if (net_type(lex))
+      {
+      declaration(-1);
+      expect(";");
+      }
+    else if (lex.is("assign"))
+      assign();
+    else if (lex.type == VT_ID && !lex.is("always") && !lex.is("initial") && !lex.is("reg") &&
+             !lex.is("integer") && !lex.is("real") && !lex.is("time") && !lex.is("event") &&
+             !lex.is("parameter") && !lex.is("localparam") && !lex.is("defparam") && !lex.is("genvar") &&
+             !lex.is("function") && !lex.is("task") && !lex.is("generate") && !lex.is("specify"))
+      instance();
+    else
+      skip_item();
+    span.len = lex.before - span.s;
+    if (!decl)
+      m->items.add(span);
+    }
+  lex.next();
+  if (m->model)
+    {
+    // Copy code before the file goes away
+    int x;
+    for (x = 0; x != m->regs.len(); ++x)
+      m->text.add(m->regs[x]);
+    for (x = 0; x != m->items.len(); ++x)
+      m->text.add(string(m->items[x].s, m->items[x].len));
+    }
+  m->items.clear();
+  }
+
+// Nets of a module while it's being built: bits joined by union-find
+
+struct VNets
+  {
+  Hash<int> index; // Bit name to node
+  Array<string> names;
+  Array<int> up; // Parent node or itself
+  Array<Portref *> pins; // Pins of root nodes
+
+  int node(const string& name)
+    {
+    Hash<int>::ptr p = index.find(name);
+    if (p)
+      return *p;
+    int n = names.len();
+    index.add(name, n);
+    names.add(name);
+    up.add(n);
+    pins.add(0);
+    return n;
+    }
+
+  int find(int n)
+    {
+    int r = n;
+    while (up[r] != r)
+      r = up[r];
+    while (up[n] != r)
+      {
+      int t = up[n];
+      up[n] = r;
+      n = t;
+      }
+    return r;
+    }
+
+  // Join two nodes: the older one (like a port) names the net
+  void join(int a, int b)
+    {
+    a = find(a);
+    b = find(b);
+    if (a == b)
+      return;
+    if (b < a)
+      {
+      int t = a;
+      a = b;
+      b = t;
+      }
+    up[b] = a;
+    // Move pins
+    Portref *r = pins[b];
+    while (r)
+      {
+      Portref *n = r->next;
+      r->next = pins[a];
+      pins[a] = r;
+      r = n;
+      }
+    pins[b] = 0;
+    }
+
+  void add_pin(int n, Portref *r)
+    {
+    n = find(n);
+    r->next = pins[n];
+    pins[n] = r;
+    }
+  };
+
+// Ports of cell we don't have a module for
+
+static Port *extern_port(View *v, const string& name, int dir)
+  {
+  Port *p = v->ports.get(name);
+  if (!p)
+    {
+    p = new Port();
+    p->name.name = name;
+    p->mom = v;
+    p->direction = dir;
+    v->ports.add(name, p);
+    }
+  return p;
+  }
+
+// Cell we don't have a module for
+
+static View *extern_view(Design *d, const string& name)
+  {
+  Lib *l = d->libraries.get("verilog");
+  if (!l)
+    {
+    l = new Lib();
+    l->lib_type = 1;
+    l->name.name = "verilog";
+    l->mom = d;
+    d->libraries.add(l->name.name, l);
+    }
+  Cell *c = l->cells.get(name);
+  if (!c)
+    {
+    c = new Cell();
+    c->name.name = name;
+    c->mom = l;
+    l->cells.add(name, c);
+    View *v = new View();
+    v->name.name = "netlist";
+    v->mom = c;
+    c->views.add("netlist", v);
+    }
+  return *c->views.first();
+  }
+
+// Gate primitive with n terminals: a cell like and3 in library verilog.
+// It's added to the gate map so that it's written back as a primitive.
+
+static View *prim_view(Design *d, const string& prim, int n)
+  {
+  char buf[20];
+  int x;
+  sprintf(buf, "%d", n);
+  View *v = extern_view(d, prim + buf);
+  if (v->ports.len())
+    return v;
+  GateMap *g = new GateMap();
+  g->library = "verilog";
+  g->part = prim + buf;
+  g->prim = prim;
+  if (prim == "buf" || prim == "not")
+    {
+    // Outputs, then one input
+    for (x = 1; x < n; ++x)
+      {
+      sprintf(buf, "y%d", x);
+      g->pins.add(n == 2 ? string("y") : string(buf));
+      }
+    g->pins.add("a");
+    }
+  else
+    {
+    g->pins.add("y");
+    if (prim.find("if") != string::npos)
+      {
+      g->pins.add("a");
+      g->pins.add("en");
+      }
+    else
+      for (x = 1; x < n; ++x)
+        {
+        sprintf(buf, "i%d", x);
+        g->pins.add(n <= 27 ? string(1, 'a' + x - 1) : string(buf));
+        }
+    }
+  for (x = 0; x != g->pins.len(); ++x)
+    extern_port(v, g->pins[x], x < (prim == "buf" || prim == "not" ? n - 1 : 1) ? 1 : 0);
+  if (!gatemap_find(v->mom))
+    gatemap_add(g);
+  else
+    delete g; // Already there if we're loading again
+  return v;
+  }
+
+// Ports connected by a connection, msb first
+
+static void conn_ports(VRead& rd, VInst *vi, View *target, VModule *tm, VConn *c, int pos, Array<Port *>& out)
+  {
+  Array<string> names;
+  string port = c->port;
+  int x;
+  int dir = 2;
+  if (port == "")
+    {
+    // Positional
+    if (tm)
+      {
+      if (pos >= tm->port_order.len())
+        {
+        cerr << rd.lex.name << " " << vi->line << ": Error: too many connections for " << vi->cell << "\n";
+        return;
+        }
+      port = tm->port_order[pos];
+      }
+    else if (is_prim(vi->cell))
+      {
+      // prim_view() made ports in terminal order
+      Hash<Port *>::ptr pp = target->ports.first();
+      for (x = 0; x != pos && pp; ++x)
+        pp++;
+      if (pp && c->bits.len() == 1)
+        out.add(*pp);
+      else
+        cerr << rd.lex.name << " " << vi->line << ": Error: bad connection to gate " << vi->name << "\n";
+      return;
+      }
+    else
+      {
+      char buf[20];
+      sprintf(buf, "%d", pos + 1);
+      port = buf;
+      }
+    }
+  if (tm)
+    rd.bits(port, tm->ranges.get(port), names);
+  else if (c->bits.len() <= 1)
+    names.add(port);
+  else
+    {
+    VRange r;
+    r.msb = c->bits.len() - 1;
+    r.lsb = 0;
+    rd.bits(port, &r, names);
+    }
+  for (x = 0; x != names.len(); ++x)
+    {
+    Port *p = tm ? target->ports.get(names[x]) : extern_port(target, names[x], dir);
+    if (!p)
+      {
+      cerr << rd.lex.name << " " << vi->line << ": Error: module " << vi->cell << " has no port " << names[x] << "\n";
+      out.add(0);
+      }
+    else
+      out.add(p);
+    }
+  }
+
+// Build module's view from what we parsed
+
+static void build_view(VRead& rd, Design *d, VModule *m)
+  {
+  View *v = m->view;
+  VNets nets;
+  Hash<Port *>::ptr pp;
+  int x, y, z;
+
+  // Port nets first so that nets are named after ports
+  for (pp = v->ports.first(); pp; pp++)
+    {
+    Portref *r = new Portref();
+    r->portRef = pp->name.name;
+    r->port = *pp;
+    nets.add_pin(nets.node(pp->name.name), r);
+    }
+
+  if (m->model)
+    {
+    // Keep ports and code
+    for (x = 0; x != m->text.len(); ++x)
+      v->sim.add(m->text[x]);
+    for (pp = v->ports.first(); pp; pp++)
+      if (strchr(pp->name.name.c_str(), '['))
+        {
+        cerr << rd.lex.name << " " << m->line << ": Warning: vector ports of module " << m->name << " are split into bits, its code will need editing\n";
+        break;
+        }
+    }
+  else
+    {
+    for (x = 0; x != m->wires.len(); ++x)
+      nets.node(m->wires[x]);
+    for (x = 0; x != m->aliases.len(); x += 2)
+      nets.join(nets.node(m->aliases[x]), nets.node(m->aliases[x + 1]));
+
+    for (x = 0; x != m->insts.len(); ++x)
+      {
+      VInst *vi = m->insts[x];
+      VModule *tm = rd.modules.get(vi->cell);
+      View *target = tm ? tm->view : is_prim(vi->cell) ? prim_view(d, vi->cell, vi->conns.len()) : extern_view(d, vi->cell);
+      Instance *i = new Instance();
+      i->name.name = vi->name;
+      i->mom = v;
+      i->ref.viewRef = target->name.name;
+      i->ref.cellRef = target->mom->name.name;
+      i->ref.libraryRef = target->mom->mom->name.name;
+      i->ref.view = target;
+      i->ref.cell = target->mom;
+      i->ref.lib = target->mom->mom;
+      if (v->instances.get(vi->name))
+        {
+        cerr << rd.lex.name << " " << vi->line << ": Error: instance " << vi->name << " defined twice\n";
+        continue;
+        }
+      v->instances.add(vi->name, i);
+      for (y = 0; y != vi->conns.len(); ++y)
+        {
+        VConn *c = vi->conns[y];
+        Array<Port *> ports;
+        conn_ports(rd, vi, target, tm, c, y, ports);
+        if (ports.len() != c->bits.len() && c->bits.len())
+          cerr << rd.lex.name << " " << vi->line << ": Warning: width mismatch on " << vi->name << " port " << (c->port == "" ? "#" : c->port) << "\n";
+        // Line up lsbs
+        for (z = 1; z <= ports.len() && z <= c->bits.len(); ++z)
+          {
+          Port *p = ports[ports.len() - z];
+          string& bit = c->bits[c->bits.len() - z];
+          if (!p || bit == "")
+            continue;
+          Portref *r = new Portref();
+          r->portRef = p->name.name;
+          r->instanceRef = vi->name;
+          r->port = p;
+          r->instance = i;
+          nets.add_pin(nets.node(bit), r);
+          }
+        }
+      }
+    }
+
+  // Make nets
+  for (x = 0; x != nets.names.len(); ++x)
+    if (nets.find(x) == x)
+      {
+      Net *n = new Net();
+      n->name.name = nets.names[x];
+      n->mom = v;
+      n->pins = nets.pins[x];
+      v->nets.add(n->name.name, n);
+      }
+
+  // Constants are wires which need to be driven
+  if (nets.index.find("1'b0"))
+    v->sim.add("assign \\1'b0  = 1'b0;");
+  if (nets.index.find("1'b1"))
+    v->sim.add("assign \\1'b1  = 1'b1;");
+  }
+
+Design *verilog_load(const char *name)
+  {
+  VRead rd;
+  struct stat st;
+  char *buf;
+  int fd = open(name, O_RDONLY);
+  if (fd == -1 || fstat(fd, &st))
+    {
+    cerr << "couldn't open " << name << "\n";
+    if (fd != -1)
+      close(fd);
+    return 0;
+    }
+  cout << "Loading " << name << "\n";
+  buf = 0;
+  if (st.st_size)
+    {
+    buf = (char *)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf == MAP_FAILED)
+      {
+      cerr << "couldn't read " << name << "\n";
+      close(fd);
+      return 0;
+      }
+    }
+  rd.lex.name = name;
+  rd.lex.p = buf;
+  rd.lex.end = buf + st.st_size;
+  rd.lex.line = 1;
+  rd.lex.s = buf;
+  rd.lex.len = 0;
+  rd.nonames = 0;
+  try
+    {
+    rd.lex.next();
+    while (rd.lex.type != VT_EOF)
+      if (rd.lex.is("module") || rd.lex.is("macromodule"))
+        rd.module();
+      else if (rd.lex.is("primitive"))
+        rd.skip_until("endprimitive");
+      else
+        rd.lex.error("expected module");
+    }
+  catch (LoadError)
+    {
+    if (buf)
+      munmap(buf, st.st_size);
+    close(fd);
+    throw;
+    }
+
+  if (buf)
+    munmap(buf, st.st_size);
+  close(fd);
+
+  // Build cells and ports first so that instances can refer to them
+  Design *d = new Design();
+  Lib *lib = new Lib();
+  lib->lib_type = 0;
+  lib->name.name = "main";
+  lib->mom = d;
+  d->libraries.add("main", lib);
+  Hash<VModule *>::ptr mp;
+  int x;
+  for (mp = rd.modules.first(); mp; mp++)
+    {
+    VModule *m = *mp;
+    Cell *c = new Cell();
+    c->name.name = m->name;
+    c->mom = lib;
+    lib->cells.add(c->name.name, c);
+    View *v = new View();
+    v->name.name = "netlist";
+    v->mom = c;
+    c->views.add("netlist", v);
+    m->cell = c;
+    m->view = v;
+    for (x = 0; x != m->port_order.len(); ++x)
+      {
+      string pname = m->port_order[x];
+      Array<string> names;
+      int y;
+      int dir = m->dirs.get(pname);
+      if (!dir)
+        {
+        cerr << name << " " << m->line << ": Warning: port " << pname << " of module " << m->name << " has no direction\n";
+        dir = 3;
+        }
+      rd.bits(pname, m->ranges.get(pname), names);
+      for (y = 0; y != names.len(); ++y)
+        {
+        Port *p = new Port();
+        p->name.name = names[y];
+        p->mom = v;
+        p->direction = dir - 1;
+        v->ports.add(p->name.name, p);
+        }
+      }
+    }
+
+  cout << "Linking...\n";
+  for (mp = rd.modules.first(); mp; mp++)
+    build_view(rd, d, *mp);
+
+  Cell *top = find_top(d);
+  if (top)
+    d->name.name = top->name.name;
+  return d;
+  }
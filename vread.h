@@ -0,0 +1,6 @@
+// Verilog netlist reader
+// Copyright (C) 2008 Joseph H. Allen
+// See file COPYING for license.
+
+// Load structural verilog file into a linked design
+Design *verilog_load(const char *name);